@@ -0,0 +1,76 @@
+#ifndef ANILLO_H
+#define ANILLO_H
+
+// Anillo de bytes de un productor y un consumidor (SPSC) sin bloqueos, pensado
+// para vivir en una región de memoria compartida entre procesos (shm_open +
+// mmap). Se comporta como una tubería en espacio de usuario: el productor copia
+// bytes hacia adentro y el consumidor hacia afuera, sin pasar por el kernel.
+// El productor sólo escribe 'cabeza' y el consumidor sólo escribe 'cola'; cada
+// índice vive en su propia línea de caché para que no rebote entre núcleos.
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LINEA_CACHE 64
+#define ANILLO_CAPACIDAD (1 << 20)   // Bytes; debe ser potencia de dos
+
+typedef struct {
+    _Alignas(LINEA_CACHE) _Atomic uint64_t cabeza; // Total de bytes publicados
+    _Alignas(LINEA_CACHE) _Atomic uint64_t cola;   // Total de bytes consumidos
+    _Alignas(LINEA_CACHE) _Atomic int cerrado;     // El productor no enviará más
+    _Alignas(LINEA_CACHE) char datos[ANILLO_CAPACIDAD];
+} anillo_t;
+
+static inline void anillo_iniciar(anillo_t *a) {
+    atomic_store_explicit(&a->cabeza, 0, memory_order_relaxed);
+    atomic_store_explicit(&a->cola, 0, memory_order_relaxed);
+    atomic_store_explicit(&a->cerrado, 0, memory_order_relaxed);
+}
+
+// Productor: copia hasta n bytes y devuelve cuántos cupieron (0 si está lleno).
+static inline size_t anillo_escribir(anillo_t *a, const void *buf, size_t n) {
+    uint64_t cabeza = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+    uint64_t cola = atomic_load_explicit(&a->cola, memory_order_acquire);
+    size_t libre = ANILLO_CAPACIDAD - (size_t)(cabeza - cola);
+    if (n > libre) n = libre;
+    if (n == 0) return 0;
+
+    size_t inicio = cabeza & (ANILLO_CAPACIDAD - 1);
+    size_t primero = ANILLO_CAPACIDAD - inicio < n ? ANILLO_CAPACIDAD - inicio : n;
+    memcpy(a->datos + inicio, buf, primero);
+    memcpy(a->datos, (const char *)buf + primero, n - primero);
+    atomic_store_explicit(&a->cabeza, cabeza + n, memory_order_release);
+    return n;
+}
+
+// Consumidor: copia hasta n bytes y devuelve cuántos había (0 si está vacío).
+static inline size_t anillo_leer(anillo_t *a, void *buf, size_t n) {
+    uint64_t cola = atomic_load_explicit(&a->cola, memory_order_relaxed);
+    uint64_t cabeza = atomic_load_explicit(&a->cabeza, memory_order_acquire);
+    size_t disponible = (size_t)(cabeza - cola);
+    if (n > disponible) n = disponible;
+    if (n == 0) return 0;
+
+    size_t inicio = cola & (ANILLO_CAPACIDAD - 1);
+    size_t primero = ANILLO_CAPACIDAD - inicio < n ? ANILLO_CAPACIDAD - inicio : n;
+    memcpy(buf, a->datos + inicio, primero);
+    memcpy((char *)buf + primero, a->datos, n - primero);
+    atomic_store_explicit(&a->cola, cola + n, memory_order_release);
+    return n;
+}
+
+static inline void anillo_cerrar(anillo_t *a) {
+    atomic_store_explicit(&a->cerrado, 1, memory_order_release);
+}
+
+// Consumidor: verdadero cuando el productor cerró y no quedan bytes pendientes.
+// 'cerrado' se lee antes que 'cabeza' para no perder la última publicación.
+static inline int anillo_agotado(anillo_t *a) {
+    if (!atomic_load_explicit(&a->cerrado, memory_order_acquire)) return 0;
+    uint64_t cola = atomic_load_explicit(&a->cola, memory_order_relaxed);
+    return atomic_load_explicit(&a->cabeza, memory_order_acquire) == cola;
+}
+
+#endif
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <math.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// Banco de pruebas del pipeline de server.c: genera una carga reproducible
+// (cantidad de mensajes, distribución de tamaños, contenido aleatorio o fijo),
+// la pasa por ./server en modo flujo con cada transporte/notificación pedido y
+// junta los reportes del servidor (--formato csv|json) en un solo resultado.
+// Con -u cada modo se corre además con otras opciones de ubicación (CPUs,
+// SCHED_FIFO, páginas enormes) para compararlas con la corrida sin fijar.
+//
+// Compilar: gcc -O2 -o benchmark benchmark.c -lm
+
+#define MAX_MODOS 16
+#define MAX_ARGUMENTOS 64
+#define MAX_VARIANTES 8
+#define MAX_ARGS_VARIANTE 8
+#define TAM_MAXIMO_MENSAJE (16 * 1024 * 1024)
+
+enum distribucion { DIST_FIJA, DIST_UNIFORME, DIST_EXPONENCIAL };
+
+// Generador xorshift64*: la misma semilla produce la misma carga en cualquier máquina.
+uint64_t estado_aleatorio = 1;
+
+uint64_t aleatorio(void) {
+    estado_aleatorio ^= estado_aleatorio >> 12;
+    estado_aleatorio ^= estado_aleatorio << 25;
+    estado_aleatorio ^= estado_aleatorio >> 27;
+    return estado_aleatorio * 0x2545F4914F6CDD1DULL;
+}
+
+double aleatorio_unitario(void) {
+    return (aleatorio() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void uso(const char *programa) {
+    fprintf(stderr, "Uso: %s [-n mensajes] [-d fijo:N|uniforme:MIN:MAX|exponencial:MEDIA]\n"
+                    "          [-c aleatorio|fijo] [-s semilla] [-m modo[,modo...]] [-F csv|json]\n"
+                    "          [-o archivo] [-S servidor] [-u \"opciones de ubicación\"]...\n"
+                    "          [-- opciones extra del servidor]\n", programa);
+    fprintf(stderr, "  -n  cantidad de mensajes (por defecto 100000)\n");
+    fprintf(stderr, "  -d  distribución de tamaños en bytes (por defecto fijo:64)\n");
+    fprintf(stderr, "  -c  contenido de cada mensaje (por defecto aleatorio)\n");
+    fprintf(stderr, "  -m  transporte[:notificación] a medir (por defecto fifo,shm:futex,shm:eventfd,shm:giro)\n");
+    fprintf(stderr, "  -F  formato del resultado (por defecto csv)\n");
+    fprintf(stderr, "  -S  ruta del servidor (por defecto ./server)\n");
+    fprintf(stderr, "  -u  variante de ubicación; cada modo corre sin fijar y una vez por cada -u\n");
+    fprintf(stderr, "Ejemplo: %s -n 50000 -d exponencial:200 -F json -- --pipeline=64 --lote 16\n", programa);
+    fprintf(stderr, "Escalado: %s -m shm -- --pipeline=64 --replicas 1,2,4,8\n", programa);
+    fprintf(stderr, "Ubicación: %s -m shm -u \"--cpus 0/1/2/3\" -u \"--cpus 0/1/2/3 --prioridad-fifo 10\"\n",
+            programa);
+}
+
+// Escribe la carga en 'archivo', un mensaje por línea.
+int generar_carga(FILE *archivo, long mensajes, enum distribucion dist, long a, long b, int aleatorio_contenido) {
+    static const char patron[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    char *linea = malloc(TAM_MAXIMO_MENSAJE + 1);
+    if (linea == NULL) {
+        perror("malloc");
+        return -1;
+    }
+    for (long m = 0; m < mensajes; m++) {
+        long tam;
+        switch (dist) {
+            case DIST_UNIFORME:    tam = a + (long)(aleatorio() % (uint64_t)(b - a + 1)); break;
+            case DIST_EXPONENCIAL: tam = (long)(-a * log(1.0 - aleatorio_unitario())); break;
+            default:               tam = a; break;
+        }
+        if (tam < 1) tam = 1; // El servidor descarta las líneas vacías
+        if (tam > TAM_MAXIMO_MENSAJE) tam = TAM_MAXIMO_MENSAJE;
+        for (long i = 0; i < tam; i++) {
+            // Caracteres imprimibles: nunca '\n', que separa los mensajes.
+            linea[i] = aleatorio_contenido ? (char)(' ' + aleatorio() % 95) : patron[i % (sizeof(patron) - 1)];
+        }
+        linea[tam] = '\n';
+        if (fwrite(linea, 1, tam + 1, archivo) != (size_t)tam + 1) {
+            perror("fwrite carga");
+            free(linea);
+            return -1;
+        }
+    }
+    free(linea);
+    return fflush(archivo);
+}
+
+// Ejecuta el servidor con 'argv' y devuelve su salida estándar completa (a liberar).
+char *ejecutar_servidor(char *const argv[], int *estado) {
+    int tuberia[2];
+    if (pipe(tuberia) == -1) {
+        perror("pipe");
+        return NULL;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return NULL;
+    }
+    if (pid == 0) {
+        close(tuberia[0]);
+        dup2(tuberia[1], STDOUT_FILENO);
+        close(tuberia[1]);
+        execv(argv[0], argv);
+        perror("execv servidor");
+        exit(EXIT_FAILURE);
+    }
+    close(tuberia[1]);
+
+    size_t capacidad = 4096, usado = 0;
+    char *salida = malloc(capacidad);
+    ssize_t r;
+    while (salida != NULL && (r = read(tuberia[0], salida + usado, capacidad - usado - 1)) > 0) {
+        usado += r;
+        if (capacidad - usado == 1) salida = realloc(salida, capacidad *= 2);
+    }
+    close(tuberia[0]);
+    waitpid(pid, estado, 0);
+    if (salida != NULL) salida[usado] = '\0';
+    return salida;
+}
+
+int main(int argc, char *argv[]) {
+    long mensajes = 100000, dist_a = 64, dist_b = 64;
+    enum distribucion dist = DIST_FIJA;
+    int contenido_aleatorio = 1, json = 0;
+    const char *servidor = "./server", *destino = NULL;
+    char modos_texto[256] = "fifo,shm:futex,shm:eventfd,shm:giro";
+    // Variante 0: sin opciones de ubicación, la referencia contra la que se comparan las demás.
+    char *variantes[MAX_VARIANTES + 1][MAX_ARGS_VARIANTE + 1] = { { NULL } };
+    int num_variantes = 1;
+
+    int opcion;
+    while ((opcion = getopt(argc, argv, "n:d:c:s:m:F:o:S:u:h")) != -1) {
+        switch (opcion) {
+            case 'n': mensajes = atol(optarg); break;
+            case 'd':
+                if (sscanf(optarg, "fijo:%ld", &dist_a) == 1) {
+                    dist = DIST_FIJA;
+                } else if (sscanf(optarg, "uniforme:%ld:%ld", &dist_a, &dist_b) == 2 && dist_b >= dist_a) {
+                    dist = DIST_UNIFORME;
+                } else if (sscanf(optarg, "exponencial:%ld", &dist_a) == 1) {
+                    dist = DIST_EXPONENCIAL;
+                } else {
+                    fprintf(stderr, "Distribución inválida: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'c': contenido_aleatorio = strcmp(optarg, "fijo") != 0; break;
+            case 's': estado_aleatorio = strtoull(optarg, NULL, 10) | 1; break;
+            case 'm': snprintf(modos_texto, sizeof(modos_texto), "%s", optarg); break;
+            case 'F': json = strcmp(optarg, "json") == 0; break;
+            case 'o': destino = optarg; break;
+            case 'S': servidor = optarg; break;
+            case 'u': {
+                if (num_variantes > MAX_VARIANTES) {
+                    fprintf(stderr, "Demasiadas variantes de ubicación (máximo %d)\n", MAX_VARIANTES);
+                    return EXIT_FAILURE;
+                }
+                // Se parte aquí con strtok_r: el bucle de reportes usa strtok.
+                int k = 0;
+                char *resto, *arg;
+                for (arg = strtok_r(optarg, " \t", &resto); arg != NULL && k < MAX_ARGS_VARIANTE;
+                     arg = strtok_r(NULL, " \t", &resto)) {
+                    variantes[num_variantes][k++] = arg;
+                }
+                if (arg != NULL) {
+                    fprintf(stderr, "Demasiadas opciones en la variante de ubicación\n");
+                    return EXIT_FAILURE;
+                }
+                variantes[num_variantes++][k] = NULL;
+                break;
+            }
+            case 'h': uso(argv[0]); return EXIT_SUCCESS;
+            default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    char **extra = &argv[optind];
+    int num_extra = argc - optind;
+    if (num_extra > MAX_ARGUMENTOS - 16 - MAX_ARGS_VARIANTE) {
+        fprintf(stderr, "Demasiadas opciones extra para el servidor\n");
+        return EXIT_FAILURE;
+    }
+
+    char *modos[MAX_MODOS];
+    int num_modos = 0;
+    for (char *m = strtok(modos_texto, ","); m != NULL && num_modos < MAX_MODOS; m = strtok(NULL, ",")) {
+        modos[num_modos++] = m;
+    }
+
+    // La carga se genera una sola vez; todos los modos leen exactamente los mismos bytes.
+    char ruta_carga[] = "/tmp/benchmark_carga_XXXXXX";
+    int fd_carga = mkstemp(ruta_carga);
+    FILE *carga = fd_carga == -1 ? NULL : fdopen(fd_carga, "w");
+    if (carga == NULL) {
+        perror("mkstemp carga");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "benchmark: generando %ld mensajes en %s...\n", mensajes, ruta_carga);
+    if (generar_carga(carga, mensajes, dist, dist_a, dist_b, contenido_aleatorio) == -1) {
+        unlink(ruta_carga);
+        return EXIT_FAILURE;
+    }
+    fclose(carga);
+
+    FILE *salida = stdout;
+    if (destino != NULL && (salida = fopen(destino, "w")) == NULL) {
+        perror(destino);
+        unlink(ruta_carga);
+        return EXIT_FAILURE;
+    }
+
+    int fallos = 0, primero = 1;
+    if (json) fprintf(salida, "[\n");
+    // Cada modo corre primero sin fijar y después con cada variante de -u.
+    for (int c = 0; c < num_modos * num_variantes; c++) {
+        int i = c / num_variantes, v = c % num_variantes;
+        char transporte[32], *notificacion;
+        snprintf(transporte, sizeof(transporte), "%s", modos[i]);
+        if ((notificacion = strchr(transporte, ':')) != NULL) *notificacion++ = '\0';
+
+        char *args[MAX_ARGUMENTOS];
+        int n = 0;
+        args[n++] = (char *)servidor;
+        args[n++] = "--flujo";
+        args[n++] = "--transporte";
+        args[n++] = transporte;
+        if (notificacion != NULL) {
+            args[n++] = "--notificacion";
+            args[n++] = notificacion;
+        }
+        args[n++] = "--formato";
+        args[n++] = json ? "json" : "csv";
+        for (int k = 0; variantes[v][k] != NULL; k++) args[n++] = variantes[v][k];
+        for (int k = 0; k < num_extra; k++) args[n++] = extra[k];
+        args[n++] = ruta_carga;
+        args[n] = NULL;
+
+        fprintf(stderr, "benchmark: midiendo %s%s...\n", modos[i], v > 0 ? " (variante de ubicación)" : "");
+        int estado = 0;
+        char *reporte = ejecutar_servidor(args, &estado);
+        if (reporte == NULL || !WIFEXITED(estado) || WEXITSTATUS(estado) != 0) {
+            fprintf(stderr, "benchmark: el modo %s falló\n", modos[i]);
+            fallos++;
+        }
+        // Cada línea del servidor es una corrida; en CSV sólo se conserva la primera cabecera.
+        for (char *linea = reporte ? strtok(reporte, "\n") : NULL; linea != NULL; linea = strtok(NULL, "\n")) {
+            if (json) {
+                if (linea[0] != '{') continue;
+                fprintf(salida, "%s  %s", primero ? "" : ",\n", linea);
+            } else {
+                if (strncmp(linea, "transporte,", 11) == 0 && !primero) continue;
+                fprintf(salida, "%s\n", linea);
+            }
+            primero = 0;
+        }
+        free(reporte);
+    }
+    if (json) fprintf(salida, "%s]\n", primero ? "" : "\n");
+
+    if (salida != stdout) fclose(salida);
+    unlink(ruta_carga);
+    return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
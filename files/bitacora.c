@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <getopt.h>
+
+#include "bitacora.h"
+
+// Decodificador de la bitácora binaria que escribe ./server --bitacora archivo.
+// Cada proceso vuelca sus registros por bloques, así que en el archivo quedan
+// intercalados por bloque; por defecto se ordenan por tiempo antes de mostrarlos.
+//
+// Compilar: gcc -O2 -o bitacora bitacora.c
+// Uso típico: ./server -f --bitacora corrida.bin --nivel-bitacora depuracion archivo.txt
+//             ./bitacora corrida.bin
+
+typedef struct {
+    const registro_t *registro;
+    size_t posicion;            // Para desempatar y conservar el orden del archivo
+} entrada_t;
+
+int comparar_entradas(const void *a, const void *b) {
+    const entrada_t *x = a, *y = b;
+    if (x->registro->ns != y->registro->ns) return x->registro->ns < y->registro->ns ? -1 : 1;
+    return x->posicion < y->posicion ? -1 : x->posicion > y->posicion;
+}
+
+// El mismo nombre que usa el servidor para la etapa: "Servidor", "Cliente 2" o "Cliente 2.1".
+void nombre_proceso(const registro_t *r, char *nombre, size_t tam) {
+    if (r->etapa == 0) {
+        snprintf(nombre, tam, "Servidor");
+    } else if (r->replicas > 1) {
+        snprintf(nombre, tam, "Cliente %d.%d", r->etapa, r->replica);
+    } else {
+        snprintf(nombre, tam, "Cliente %d", r->etapa);
+    }
+}
+
+void mostrar_carga(const registro_t *r) {
+    if (r->carga == 0) return;
+    const unsigned char *c = (const unsigned char *)(r + 1);
+    printf(" '");
+    for (int i = 0; i < r->carga; i++) {
+        if (c[i] == '\'' || c[i] == '\\') printf("\\%c", c[i]);
+        else if (isprint(c[i])) putchar(c[i]);
+        else printf("\\x%02x", c[i]);
+    }
+    printf("'%s", r->carga < r->longitud ? "..." : "");
+}
+
+void mostrar(const registro_t *r, uint64_t inicio_ns) {
+    char nombre[32];
+    nombre_proceso(r, nombre, sizeof(nombre));
+    double ms = r->ns >= inicio_ns ? (r->ns - inicio_ns) / 1e6 : 0.0;
+    const char *evento = r->evento < NUM_EVENTOS ? nombres_eventos[r->evento] : "?";
+    printf("%12.3f ms  %-12s %7u  %-12s ", ms, nombre, r->pid, evento);
+    unsigned long long secuencia = (unsigned long long)r->secuencia;
+    switch (r->evento) {
+        case EVENTO_INICIO:
+            break;
+        case EVENTO_FIN:
+            printf("%llu mensajes", secuencia);
+            if (r->longitud > 0) printf(", %u no coinciden", r->longitud);
+            break;
+        case EVENTO_ENVIADO:
+        case EVENTO_PROCESADO:
+        case EVENTO_RECIBIDO:
+            printf("mensaje %llu, %u B", secuencia, r->longitud);
+            mostrar_carga(r);
+            break;
+        case EVENTO_LEIDO:
+        case EVENTO_TRANSFORMADO:
+            printf("%u B", r->longitud);
+            mostrar_carga(r);
+            break;
+        case EVENTO_DISCREPANCIA:
+            printf("mensaje %llu no coincide (%u B)", secuencia, r->longitud);
+            break;
+        case EVENTO_FALLO:
+            printf("mensaje %llu: %s", secuencia, strerror(r->longitud));
+            break;
+        case EVENTO_DESCARTADO:
+        case EVENTO_RECHAZADO:
+            printf("llegada %llu, %u B (cola llena)", secuencia, r->longitud);
+            break;
+        case EVENTO_CONEXION:
+            printf("sesión %llu", secuencia);
+            break;
+        case EVENTO_DESCONEXION:
+            printf("sesión %llu%s%s", secuencia, r->longitud ? ": " : "", r->longitud ? strerror(r->longitud) : "");
+            break;
+        case EVENTO_PERDIDOS:
+            printf("%u registros descartados (anillo lleno)", r->longitud);
+            break;
+        default:
+            printf("evento desconocido %u", r->evento);
+    }
+    putchar('\n');
+}
+
+void uso(const char *programa) {
+    fprintf(stderr, "Uso: %s [-n error|info|depuracion] [-a] archivo\n", programa);
+    fprintf(stderr, "  -n  muestra sólo los registros de ese nivel o más graves (por defecto todos)\n");
+    fprintf(stderr, "  -a  en el orden del archivo, sin ordenar por tiempo\n");
+}
+
+int main(int argc, char *argv[]) {
+    enum nivel_bitacora nivel = BITACORA_DEPURACION;
+    int ordenar = 1, opcion;
+    while ((opcion = getopt(argc, argv, "n:ah")) != -1) {
+        switch (opcion) {
+            case 'n':
+                if (strcmp(optarg, "error") == 0) {
+                    nivel = BITACORA_ERROR;
+                } else if (strcmp(optarg, "info") == 0) {
+                    nivel = BITACORA_INFO;
+                } else if (strcmp(optarg, "depuracion") == 0) {
+                    nivel = BITACORA_DEPURACION;
+                } else {
+                    fprintf(stderr, "Nivel desconocido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'a': ordenar = 0; break;
+            case 'h': uso(argv[0]); return EXIT_SUCCESS;
+            default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1) {
+        uso(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *f = fopen(argv[optind], "rb");
+    if (f == NULL) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+    bitacora_cabecera_t cabecera;
+    if (fread(&cabecera, sizeof(cabecera), 1, f) != 1 || memcmp(cabecera.magia, BITACORA_MAGIA, 8) != 0 ||
+        cabecera.version != BITACORA_VERSION || cabecera.tam_registro != BITACORA_REGISTRO) {
+        fprintf(stderr, "%s: no es una bitácora del servidor (o es de otra versión)\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+    // Los registros se leen completos a memoria: ordenarlos exige tenerlos todos.
+    char *datos = NULL;
+    size_t tam = 0, capacidad = 0, n;
+    for (;;) {
+        if (capacidad - tam < 65536) {
+            capacidad = capacidad ? 2 * capacidad : 1 << 20;
+            if ((datos = realloc(datos, capacidad)) == NULL) {
+                perror("realloc");
+                return EXIT_FAILURE;
+            }
+        }
+        if ((n = fread(datos + tam, 1, capacidad - tam, f)) == 0) break;
+        tam += n;
+    }
+    fclose(f);
+
+    entrada_t *entradas = NULL;
+    size_t num = 0, capacidad_entradas = 0, posicion = 0;
+    while (posicion + BITACORA_REGISTRO <= tam) {
+        const registro_t *r = (const registro_t *)(datos + posicion);
+        size_t tam_registro = bitacora_tam_registro(r->carga);
+        if (posicion + tam_registro > tam) break;
+        if (num == capacidad_entradas) {
+            capacidad_entradas = capacidad_entradas ? 2 * capacidad_entradas : 4096;
+            if ((entradas = realloc(entradas, capacidad_entradas * sizeof(entrada_t))) == NULL) {
+                perror("realloc");
+                return EXIT_FAILURE;
+            }
+        }
+        entradas[num].registro = r;
+        entradas[num].posicion = posicion;
+        num++;
+        posicion += tam_registro;
+    }
+    if (posicion != tam) {
+        fprintf(stderr, "%s: %zu bytes finales incompletos ignorados\n", argv[optind], tam - posicion);
+    }
+    if (ordenar) qsort(entradas, num, sizeof(entrada_t), comparar_entradas);
+    for (size_t i = 0; i < num; i++) {
+        if (entradas[i].registro->nivel <= nivel) mostrar(entradas[i].registro, cabecera.inicio_ns);
+    }
+    free(entradas);
+    free(datos);
+    return EXIT_SUCCESS;
+}
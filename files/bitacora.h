@@ -0,0 +1,75 @@
+#ifndef BITACORA_H
+#define BITACORA_H
+
+// Formato de la bitácora binaria del servidor (--bitacora). En lugar de un
+// printf por evento, cada proceso copia registros de tamaño fijo a un anillo
+// en su propia memoria y un hilo escritor los vuelca al archivo en bloques;
+// ./bitacora los decodifica a texto. El archivo empieza con una cabecera y
+// sigue con registros de todos los procesos, cada bloque agregado con O_APPEND
+// de una sola vez, así los bloques de distintos procesos no se mezclan.
+//
+// Cada registro ocupa BITACORA_REGISTRO bytes más, si se pidió volcar la carga
+// (--carga-bitacora), hasta esa cantidad de bytes del mensaje, con relleno
+// hasta múltiplo de 8.
+
+#include <stdint.h>
+
+#define BITACORA_MAGIA "SOL2BIT"
+#define BITACORA_VERSION 1
+
+typedef struct {
+    char magia[8];
+    uint32_t version;
+    uint32_t tam_registro;
+    uint64_t inicio_ns;         // CLOCK_MONOTONIC al crear el archivo
+} bitacora_cabecera_t;
+
+// Un registro se guarda si su nivel es menor o igual al elegido.
+enum nivel_bitacora { BITACORA_NINGUNO, BITACORA_ERROR, BITACORA_INFO, BITACORA_DEPURACION };
+
+enum evento_bitacora {
+    EVENTO_INICIO,          // El proceso abrió sus canales (info)
+    EVENTO_FIN,             // El proceso terminó; 'secuencia' = mensajes (info)
+    EVENTO_ENVIADO,         // El servidor envió el mensaje 'secuencia' (depuración)
+    EVENTO_PROCESADO,       // Una etapa entregó el mensaje 'secuencia' (depuración)
+    EVENTO_RECIBIDO,        // El servidor recibió el resultado 'secuencia' (depuración)
+    EVENTO_LEIDO,           // Modo clásico: la etapa leyó la cadena (depuración)
+    EVENTO_TRANSFORMADO,    // Modo clásico: la etapa transformó la cadena (depuración)
+    EVENTO_DISCREPANCIA,    // El resultado no coincide con lo esperado (error)
+    EVENTO_FALLO,           // Error de E/S; 'longitud' = errno (error)
+    EVENTO_PERDIDOS,        // El anillo se llenó; 'longitud' = registros descartados (error)
+    EVENTO_DESCARTADO,      // Sobrecarga: se tiró la llegada 'secuencia' (depuración)
+    EVENTO_RECHAZADO,       // Sobrecarga: se rechazó la llegada 'secuencia' (depuración)
+    EVENTO_CONEXION,        // Frontal: se aceptó la sesión 'secuencia' (depuración)
+    EVENTO_DESCONEXION,     // Frontal: se cerró la sesión 'secuencia'; 'longitud' = errno o 0 (depuración)
+    NUM_EVENTOS
+};
+
+static const char *const nombres_eventos[NUM_EVENTOS] = {
+    "inicio", "fin", "enviado", "procesado", "recibido", "leido", "transformado",
+    "discrepancia", "fallo", "perdidos", "descartado", "rechazado",
+    "conexion", "desconexion",
+};
+
+typedef struct {
+    uint64_t ns;                // CLOCK_MONOTONIC
+    uint64_t secuencia;         // Número de mensaje (o el dato del evento)
+    uint32_t pid;
+    uint32_t longitud;          // Largo del mensaje (o el dato del evento)
+    uint16_t evento;
+    uint16_t carga;             // Bytes de carga que siguen al registro
+    uint8_t etapa;              // 0: servidor; 1..3: Cliente N
+    uint8_t replica;
+    uint8_t replicas;           // Réplicas de la etapa, para nombrarla como el servidor
+    uint8_t nivel;
+} registro_t;
+
+#define BITACORA_REGISTRO sizeof(registro_t)
+_Static_assert(sizeof(registro_t) == 32, "registro_t debe medir 32 bytes");
+
+// Bytes que ocupa un registro con 'carga' bytes de carga.
+static inline uint64_t bitacora_tam_registro(uint32_t carga) {
+    return (BITACORA_REGISTRO + carga + 7) & ~(uint64_t)7;
+}
+
+#endif
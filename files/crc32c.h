@@ -0,0 +1,128 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+// CRC32C (Castagnoli) incremental para verificar mensajes sin guardarlos: se
+// acumula a medida que pasan los bytes y sólo se conservan 4 bytes de estado.
+// En x86-64 con SSE4.2 usa la instrucción crc32 (8 bytes por instrucción); si
+// no, una tabla "slicing-by-8". La versión se elige una vez con seleccionar_crc32c().
+//
+// crc32c_invertido() calcula el CRC de los bytes en orden inverso sin invertirlos
+// en memoria: el servidor lo usa para obtener el CRC del resultado esperado
+// (la original invertida) a partir de la línea tal como la envió.
+//
+// El estado empieza en CRC32C_INICIAL; para comparar dos flujos basta comparar
+// los estados, no hace falta la inversión final del estándar.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define CRC32C_INICIAL 0xFFFFFFFFu
+#define CRC32C_POLINOMIO 0x82F63B78u   // Reflejado
+
+typedef uint32_t (*crc32c_t)(uint32_t crc, const void *buf, size_t len);
+
+static uint32_t crc32c_tabla[8][256];
+
+static void crc32c_iniciar_tabla(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = c & 1 ? (c >> 1) ^ CRC32C_POLINOMIO : c >> 1;
+        crc32c_tabla[0][i] = c;
+    }
+    for (int t = 1; t < 8; t++) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t c = crc32c_tabla[t - 1][i];
+            crc32c_tabla[t][i] = (c >> 8) ^ crc32c_tabla[0][c & 0xff];
+        }
+    }
+}
+
+// Los 8 bytes de 'palabra' se procesan del menos al más significativo.
+static inline uint32_t crc32c_palabra_software(uint32_t crc, uint64_t palabra) {
+    uint32_t bajo = crc ^ (uint32_t)palabra, alto = (uint32_t)(palabra >> 32);
+    return crc32c_tabla[7][bajo & 0xff] ^ crc32c_tabla[6][(bajo >> 8) & 0xff] ^
+           crc32c_tabla[5][(bajo >> 16) & 0xff] ^ crc32c_tabla[4][bajo >> 24] ^
+           crc32c_tabla[3][alto & 0xff] ^ crc32c_tabla[2][(alto >> 8) & 0xff] ^
+           crc32c_tabla[1][(alto >> 16) & 0xff] ^ crc32c_tabla[0][alto >> 24];
+}
+
+static inline uint32_t crc32c_byte_software(uint32_t crc, unsigned char b) {
+    return (crc >> 8) ^ crc32c_tabla[0][(crc ^ b) & 0xff];
+}
+
+// Palabra de 8 bytes con p[0] en el byte menos significativo, en cualquier CPU.
+static inline uint64_t crc32c_leer_le64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static uint32_t crc32c_software(uint32_t crc, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    for (; len >= 8; p += 8, len -= 8) crc = crc32c_palabra_software(crc, crc32c_leer_le64(p));
+    while (len--) crc = crc32c_byte_software(crc, *p++);
+    return crc;
+}
+
+// Recorre buf[len - 1], buf[len - 2], ..., buf[0]. Invertir el orden de una
+// palabra de 8 bytes es un bswap.
+static uint32_t crc32c_software_invertido(uint32_t crc, const void *buf, size_t len) {
+    const unsigned char *p = (const unsigned char *)buf + len;
+    for (; len >= 8; len -= 8) {
+        p -= 8;
+        crc = crc32c_palabra_software(crc, __builtin_bswap64(crc32c_leer_le64(p)));
+    }
+    while (len--) crc = crc32c_byte_software(crc, *--p);
+    return crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    uint64_t c = crc;
+    for (; len >= 8; p += 8, len -= 8) c = _mm_crc32_u64(c, crc32c_leer_le64(p));
+    while (len--) c = _mm_crc32_u8((uint32_t)c, *p++);
+    return (uint32_t)c;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42_invertido(uint32_t crc, const void *buf, size_t len) {
+    const unsigned char *p = (const unsigned char *)buf + len;
+    uint64_t c = crc;
+    for (; len >= 8; len -= 8) {
+        p -= 8;
+        c = _mm_crc32_u64(c, __builtin_bswap64(crc32c_leer_le64(p)));
+    }
+    while (len--) c = _mm_crc32_u8((uint32_t)c, *--p);
+    return (uint32_t)c;
+}
+
+#endif // __x86_64__
+
+static crc32c_t crc32c = crc32c_software;
+static crc32c_t crc32c_invertido = crc32c_software_invertido;
+static const char *crc32c_nombre = "software";
+
+static void seleccionar_crc32c(void) {
+    crc32c_iniciar_tabla();
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c = crc32c_sse42;
+        crc32c_invertido = crc32c_sse42_invertido;
+        crc32c_nombre = "sse4.2";
+    }
+#endif
+}
+
+#endif
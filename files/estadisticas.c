@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+
+#include "estadisticas.h"
+
+// Lector del segmento de estadísticas que publica ./server en modo flujo.
+// Cada intervalo imprime, por etapa, mensajes/s, MB/s, la fracción del tiempo
+// bloqueada leyendo, transformando y bloqueada escribiendo, y la cola de entrada.
+// Sólo lee: no interfiere con el pipeline más allá de compartir las líneas de caché.
+//
+// Compilar: gcc -O2 -o estadisticas estadisticas.c
+// Uso típico: ./estadisticas &  ./server -f -p archivo.txt
+
+typedef struct {
+    uint64_t mensajes, bytes, ns_lectura, ns_transformacion, ns_escritura;
+} muestra_t;
+
+void tomar_muestra(const ranura_t *r, muestra_t *m) {
+    m->mensajes = estadistica_leer(&r->mensajes);
+    m->bytes = estadistica_leer(&r->bytes);
+    m->ns_lectura = estadistica_leer(&r->ns_lectura);
+    m->ns_transformacion = estadistica_leer(&r->ns_transformacion);
+    m->ns_escritura = estadistica_leer(&r->ns_escritura);
+}
+
+// Espera a que exista el segmento de una corrida activa y lo mapea sólo lectura.
+estadisticas_t *conectar(int esperar) {
+    int avisado = 0;
+    for (;;) {
+        int fd = shm_open(SHM_ESTADISTICAS, O_RDONLY, 0);
+        if (fd != -1) {
+            estadisticas_t *e = mmap(NULL, sizeof(estadisticas_t), PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (e == MAP_FAILED) {
+                perror("mmap " SHM_ESTADISTICAS);
+                exit(EXIT_FAILURE);
+            }
+            if (atomic_load_explicit(&e->activo, memory_order_acquire)) return e;
+            munmap(e, sizeof(estadisticas_t)); // Quedó de una corrida que ya terminó
+        }
+        if (!esperar) return NULL;
+        if (!avisado) {
+            fprintf(stderr, "estadisticas: esperando a que el servidor arranque en modo flujo...\n");
+            avisado = 1;
+        }
+        usleep(100000);
+    }
+}
+
+void uso(const char *programa) {
+    fprintf(stderr, "Uso: %s [-i milisegundos] [-1]\n", programa);
+    fprintf(stderr, "  -i  intervalo entre reportes (por defecto 1000 ms)\n");
+    fprintf(stderr, "  -1  terminar al acabar la primera corrida en vez de esperar la siguiente\n");
+}
+
+int main(int argc, char *argv[]) {
+    long intervalo_ms = 1000;
+    int una_corrida = 0;
+    int opcion;
+    while ((opcion = getopt(argc, argv, "i:1h")) != -1) {
+        switch (opcion) {
+            case 'i': intervalo_ms = atol(optarg); break;
+            case '1': una_corrida = 1; break;
+            case 'h': uso(argv[0]); return EXIT_SUCCESS;
+            default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (intervalo_ms <= 0) intervalo_ms = 1000;
+
+    muestra_t anterior[ESTADISTICAS_MAX_RANURAS], actual;
+    estadisticas_t *e;
+    while ((e = conectar(1)) != NULL) {
+        int n = e->num_ranuras;
+        if (n > ESTADISTICAS_MAX_RANURAS) n = ESTADISTICAS_MAX_RANURAS;
+        printf("Corrida sobre %s con %d procesos\n", e->transporte, n);
+        uint64_t t_anterior = reloj_ns();
+        for (int i = 0; i < n; i++) tomar_muestra(&e->ranuras[i], &anterior[i]);
+
+        while (atomic_load_explicit(&e->activo, memory_order_acquire)) {
+            usleep(intervalo_ms * 1000);
+            uint64_t t = reloj_ns();
+            double dt = (t - t_anterior) / 1e9;
+            t_anterior = t;
+            printf("%-10s %7s %11s %9s %7s %7s %7s %10s %10s\n", "etapa", "pid", "mensajes/s", "MB/s",
+                   "leer%", "trans%", "escr%", "cola B", "cola máx");
+            for (int i = 0; i < n; i++) {
+                const ranura_t *r = &e->ranuras[i];
+                tomar_muestra(r, &actual);
+                muestra_t *a = &anterior[i];
+                printf("%-10s %7d %11.0f %9.2f %7.1f %7.1f %7.1f %10llu %10llu\n", r->nombre,
+                       atomic_load_explicit(&r->pid, memory_order_relaxed),
+                       (actual.mensajes - a->mensajes) / dt, (actual.bytes - a->bytes) / dt / 1e6,
+                       (actual.ns_lectura - a->ns_lectura) / 1e7 / dt,
+                       (actual.ns_transformacion - a->ns_transformacion) / 1e7 / dt,
+                       (actual.ns_escritura - a->ns_escritura) / 1e7 / dt,
+                       (unsigned long long)estadistica_leer(&r->profundidad),
+                       (unsigned long long)estadistica_leer(&r->profundidad_maxima));
+                *a = actual;
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+        printf("Corrida terminada\n");
+        fflush(stdout);
+        munmap(e, sizeof(estadisticas_t));
+        if (una_corrida) break;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+#ifndef ESTADISTICAS_H
+#define ESTADISTICAS_H
+
+// Segmento de estadísticas del modo flujo, en memoria compartida con nombre para
+// que otro proceso (./estadisticas) lo lea mientras el pipeline corre.
+// Cada proceso escribe sólo en su ranura, que ocupa sus propias líneas de caché:
+// los contadores se actualizan con carga + almacenamiento relajados, sin
+// instrucciones atómicas con lock ni rebotes de línea entre núcleos.
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef LINEA_CACHE
+#define LINEA_CACHE 64
+#endif
+
+#define SHM_ESTADISTICAS "/so_l2_estadisticas"
+#define ESTADISTICAS_MAX_RANURAS 32
+
+// La profundidad de la cola de entrada se muestrea cada tantos mensajes.
+#define PERIODO_PROFUNDIDAD 64
+
+typedef struct {
+    _Alignas(LINEA_CACHE) char nombre[16];
+    _Atomic int pid;
+    _Atomic uint64_t mensajes;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t llamadas;          // Llamadas al sistema de E/S sobre los canales
+    _Atomic uint64_t ns_lectura;        // Bloqueado esperando datos de entrada
+    _Atomic uint64_t ns_transformacion; // Dentro del kernel de la etapa
+    _Atomic uint64_t ns_escritura;      // Bloqueado esperando espacio en la salida
+    _Atomic uint64_t profundidad;       // Bytes esperando en la entrada (última muestra)
+    _Atomic uint64_t profundidad_maxima;
+} ranura_t;
+
+typedef struct {
+    _Atomic int activo;                 // 0 cuando la corrida terminó
+    int num_ranuras;
+    uint64_t inicio_ns;
+    char transporte[16];
+    ranura_t ranuras[ESTADISTICAS_MAX_RANURAS];
+} estadisticas_t;
+
+static inline uint64_t reloj_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Sólo el dueño de la ranura escribe: no hace falta un incremento atómico.
+static inline void estadistica_sumar(_Atomic uint64_t *contador, uint64_t n) {
+    atomic_store_explicit(contador, atomic_load_explicit(contador, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+static inline void estadistica_fijar(_Atomic uint64_t *contador, uint64_t valor) {
+    atomic_store_explicit(contador, valor, memory_order_relaxed);
+}
+
+static inline uint64_t estadistica_leer(const _Atomic uint64_t *contador) {
+    return atomic_load_explicit((_Atomic uint64_t *)contador, memory_order_relaxed);
+}
+
+static inline void estadistica_profundidad(ranura_t *r, uint64_t bytes) {
+    estadistica_fijar(&r->profundidad, bytes);
+    if (bytes > estadistica_leer(&r->profundidad_maxima)) estadistica_fijar(&r->profundidad_maxima, bytes);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+// Pipeline fusionado: las tres etapas aplicadas en una sola pasada sobre el
+// mensaje, dentro del mismo proceso y sin IPC. La cadena de etapas se declara
+// una vez en ETAPAS_FUSIONADAS y el preprocesador la compone en tiempo de
+// compilación: cada etapa aporta una función de byte y si invierte o no el
+// orden, así el compilador ve una única expresión por byte (que para
+// cifrar + descifrar se pliega a la identidad) y un único recorrido.
+
+#include <stddef.h>
+
+#include "transformaciones.h"
+
+// Cadena de etapas en orden, como en el pipeline de procesos.
+#define ETAPAS_FUSIONADAS(X) X(CIFRAR) X(INVERTIR) X(DESCIFRAR)
+
+// Efecto de cada etapa sobre un byte y sobre el orden de los bytes.
+#define ETAPA_BYTE_CIFRAR(c)    ((unsigned char)((c) + DESPLAZAMIENTO_CIFRADO))
+#define ETAPA_BYTE_DESCIFRAR(c) ((unsigned char)((c) - DESPLAZAMIENTO_CIFRADO))
+#define ETAPA_BYTE_INVERTIR(c)  (c)
+#define ETAPA_INVIERTE_CIFRAR    0
+#define ETAPA_INVIERTE_DESCIFRAR 0
+#define ETAPA_INVIERTE_INVERTIR  1
+
+#define FUSION_APLICAR_BYTE(etapa) c = ETAPA_BYTE_##etapa(c);
+#define FUSION_CONTAR_INVERSION(etapa) + ETAPA_INVIERTE_##etapa
+
+// Dos inversiones se cancelan: sólo importa la paridad.
+enum { FUSION_INVIERTE = (0 ETAPAS_FUSIONADAS(FUSION_CONTAR_INVERSION)) % 2 };
+
+static inline unsigned char fusion_byte(unsigned char c) {
+    ETAPAS_FUSIONADAS(FUSION_APLICAR_BYTE)
+    return c;
+}
+
+// Escribe en 'destino' el resultado de toda la cadena sobre 'origen'.
+static inline void fusion_aplicar(const char *origen, char *destino, size_t len) {
+    const unsigned char *o = (const unsigned char *)origen;
+    unsigned char *d = (unsigned char *)destino;
+    if (FUSION_INVIERTE) {
+        for (size_t i = 0; i < len; i++) d[len - 1 - i] = fusion_byte(o[i]);
+    } else {
+        for (size_t i = 0; i < len; i++) d[i] = fusion_byte(o[i]);
+    }
+}
+
+#endif
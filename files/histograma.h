@@ -0,0 +1,81 @@
+#ifndef HISTOGRAMA_H
+#define HISTOGRAMA_H
+
+// Histograma log-lineal de latencias en nanosegundos: cada potencia de dos se
+// divide en HIST_SUB cubetas, así el error relativo de un percentil es menor
+// que 1/HIST_SUB sin importar la escala y registrar cuesta unas instrucciones.
+
+#include <stdint.h>
+#include <string.h>
+
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_CUBETAS (64 * HIST_SUB)
+
+typedef struct {
+    uint64_t cuentas[HIST_CUBETAS];
+    uint64_t total;
+    uint64_t maximo;
+    double suma;
+} histograma_t;
+
+static inline void histograma_iniciar(histograma_t *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+static inline int histograma_indice(uint64_t valor) {
+    if (valor < HIST_SUB) return (int)valor;
+    int msb = 63 - __builtin_clzll(valor);
+    int sub = (int)(valor >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1);
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB + sub;
+}
+
+// Menor valor que cae en la cubeta 'indice'.
+static inline uint64_t histograma_limite(int indice) {
+    int magnitud = indice / HIST_SUB, sub = indice % HIST_SUB;
+    if (magnitud == 0) return sub;
+    return (uint64_t)(HIST_SUB + sub) << (magnitud - 1);
+}
+
+static inline void histograma_registrar(histograma_t *h, uint64_t valor) {
+    h->cuentas[histograma_indice(valor)]++;
+    h->total++;
+    h->suma += valor;
+    if (valor > h->maximo) h->maximo = valor;
+}
+
+// Valor bajo el cual queda la fracción 'p' (0..1) de las muestras; se reporta
+// el extremo superior de la cubeta, acotado por el máximo observado. El rango
+// es el más cercano hacia arriba (ceil(p * total)): con 120 muestras el p99.9
+// es la mayor, no la 119.ª. El margen relativo evita que 0.999 * 1000 redondeado
+// a 999.0000001 suba a la muestra 1000.
+static inline uint64_t histograma_percentil(const histograma_t *h, double p) {
+    if (h->total == 0) return 0;
+    double rango = p * h->total * (1 - 1e-12);
+    uint64_t objetivo = (uint64_t)rango;
+    if (objetivo < rango) objetivo++;
+    if (objetivo == 0) objetivo = 1;
+    uint64_t acumulado = 0;
+    for (int i = 0; i < HIST_CUBETAS; i++) {
+        acumulado += h->cuentas[i];
+        if (acumulado >= objetivo) {
+            uint64_t superior = i + 1 < HIST_CUBETAS ? histograma_limite(i + 1) - 1 : h->maximo;
+            return superior < h->maximo ? superior : h->maximo;
+        }
+    }
+    return h->maximo;
+}
+
+// Acumula en 'h' las muestras de 'otro' (p. ej. el histograma de cada hilo).
+static inline void histograma_sumar(histograma_t *h, const histograma_t *otro) {
+    for (int i = 0; i < HIST_CUBETAS; i++) h->cuentas[i] += otro->cuentas[i];
+    h->total += otro->total;
+    h->suma += otro->suma;
+    if (otro->maximo > h->maximo) h->maximo = otro->maximo;
+}
+
+static inline double histograma_media(const histograma_t *h) {
+    return h->total ? h->suma / h->total : 0.0;
+}
+
+#endif
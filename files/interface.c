@@ -1,15 +1,162 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
-#include <unistd.h> // Para sleep()
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
 
-int main(int argc, char* argv[]){
+#include "histograma.h"
+
+// Tarea periódica que imprime "Time: i" en cada tic. Los plazos son absolutos
+// (inicio + i * intervalo) en un timerfd sobre CLOCK_MONOTONIC, así el tiempo
+// de imprimir o un SIGSTOP/SIGCONT de main_controller no corren el calendario:
+// al volver, el tic siguiente cae donde tenía que caer y los que pasaron
+// mientras tanto se cuentan como perdidos.
+//
+// De cada tic se registra el atraso del despertar respecto de su plazo en un
+// histograma; el resumen sale al terminar, con SIGUSR1 en cualquier momento, y
+// con SIGINT o SIGTERM antes de salir.
+//
+// Compilar: gcc -O2 -o interface interface.c
+// Uso típico: ./interface                  (20 tics de 1 s, como siempre)
+//             ./interface -i 250us -n 0 -q  (sin fin; kill -USR1 para ver el jitter)
+
+// Intervalo con unidad opcional: s (por defecto), ms, us o ns. 0 si no es válido.
+uint64_t leer_intervalo(const char *texto) {
+    char *fin;
+    double valor = strtod(texto, &fin);
+    double escala = 1e9;
+    if (strcmp(fin, "ms") == 0) escala = 1e6;
+    else if (strcmp(fin, "us") == 0) escala = 1e3;
+    else if (strcmp(fin, "ns") == 0) escala = 1;
+    else if (*fin != '\0' && strcmp(fin, "s") != 0) return 0;
+    if (valor <= 0) return 0;
+    return (uint64_t)(valor * escala + 0.5);
+}
+
+uint64_t a_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+struct timespec a_timespec(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    return ts;
+}
 
-int i;
+void reportar(const histograma_t *jitter, long tics, long perdidos, uint64_t intervalo, int cubetas) {
+    printf("Interface (PID: %d): %ld tics de %.1f us, %ld plazos perdidos\n", getpid(), tics, intervalo / 1e3,
+           perdidos);
+    printf("Interface: jitter us media %.1f, p50 %.1f, p99 %.1f, p99.9 %.1f, máx. %.1f\n",
+           histograma_media(jitter) / 1e3, histograma_percentil(jitter, 0.50) / 1e3,
+           histograma_percentil(jitter, 0.99) / 1e3, histograma_percentil(jitter, 0.999) / 1e3,
+           jitter->maximo / 1e3);
+    if (cubetas) {
+        for (int i = 0; i < HIST_CUBETAS; i++) {
+            if (jitter->cuentas[i] == 0) continue;
+            printf("  >= %10.1f us  %lu\n", histograma_limite(i) / 1e3, (unsigned long)jitter->cuentas[i]);
+        }
+    }
+    fflush(stdout);
+}
 
-for(i=0;i<20;i++){
-printf("Time: %d\n",i);
-sleep(1);
+void uso(const char *programa) {
+    fprintf(stderr, "Uso: %s [-i intervalo] [-n tics] [-q] [-H]\n", programa);
+    fprintf(stderr, "  -i  período, con unidad s, ms, us o ns (por defecto 1s)\n");
+    fprintf(stderr, "  -n  cantidad de tics; 0 para seguir hasta una señal (por defecto 20)\n");
+    fprintf(stderr, "  -q  sin la línea 'Time: i' de cada tic\n");
+    fprintf(stderr, "  -H  el reporte incluye las cubetas del histograma de jitter\n");
 }
 
-return 0;
+int main(int argc, char* argv[]){
+    uint64_t intervalo = 1000000000ULL;
+    long tics = 20;
+    int silencioso = 0, cubetas = 0, opcion;
+    while ((opcion = getopt(argc, argv, "i:n:qHh")) != -1) {
+        switch (opcion) {
+            case 'i':
+                if ((intervalo = leer_intervalo(optarg)) == 0) {
+                    fprintf(stderr, "Intervalo inválido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'n': tics = atol(optarg); break;
+            case 'q': silencioso = 1; break;
+            case 'H': cubetas = 1; break;
+            case 'h': uso(argv[0]); return EXIT_SUCCESS;
+            default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+
+    // Las señales de reporte y de fin llegan por un signalfd junto al timer;
+    // SIGSTOP/SIGCONT no se pueden bloquear ni hace falta.
+    sigset_t senales;
+    sigemptyset(&senales);
+    sigaddset(&senales, SIGUSR1);
+    sigaddset(&senales, SIGINT);
+    sigaddset(&senales, SIGTERM);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    int signal_fd = -1;
+    if (timer_fd == -1 || sigprocmask(SIG_BLOCK, &senales, NULL) == -1 ||
+        (signal_fd = signalfd(-1, &senales, SFD_CLOEXEC)) == -1) {
+        perror("Interface: timerfd/signalfd");
+        return EXIT_FAILURE;
+    }
+
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    // El tic 0 sale al arrancar, como antes del primer sleep(1).
+    uint64_t inicio = a_ns(&ahora);
+    struct itimerspec plazos = { .it_interval = a_timespec(intervalo), .it_value = a_timespec(inicio) };
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &plazos, NULL) == -1) {
+        perror("Interface: timerfd_settime");
+        return EXIT_FAILURE;
+    }
+
+    histograma_t jitter;
+    histograma_iniciar(&jitter);
+    long tic = 0, perdidos = 0, registrados = 0;
+    struct pollfd fds[2] = { { .fd = timer_fd, .events = POLLIN }, { .fd = signal_fd, .events = POLLIN } };
+    while (tics == 0 || tic < tics) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            perror("Interface: poll");
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            struct signalfd_siginfo si;
+            if (read(signal_fd, &si, sizeof(si)) == sizeof(si)) {
+                reportar(&jitter, registrados, perdidos, intervalo, cubetas);
+                if (si.ssi_signo != SIGUSR1) return EXIT_SUCCESS;
+            }
+        }
+        if (!(fds[0].revents & POLLIN)) continue;
+        uint64_t vencidos;
+        if (read(timer_fd, &vencidos, sizeof(vencidos)) != sizeof(vencidos)) continue;
+        clock_gettime(CLOCK_MONOTONIC, &ahora);
+        // Con más de un vencimiento por lectura, los anteriores al último se
+        // perdieron (el proceso estuvo detenido o sin CPU); el atraso se mide
+        // respecto del último plazo vencido. Los plazos posteriores al último
+        // tic pedido no cuentan: la corrida termina justo en 'tics'.
+        if (tics != 0 && vencidos > (uint64_t)(tics - tic)) vencidos = tics - tic;
+        perdidos += vencidos - 1;
+        tic += vencidos;
+        uint64_t plazo = inicio + (tic - 1) * intervalo;
+        uint64_t despertar = a_ns(&ahora);
+        histograma_registrar(&jitter, despertar > plazo ? despertar - plazo : 0);
+        registrados++;
+        if (!silencioso) {
+            printf("Time: %ld\n", tic - 1);
+            fflush(stdout);
+        }
+    }
+
+    reportar(&jitter, registrados, perdidos, intervalo, cubetas);
+    return 0;
 }
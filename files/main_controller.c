@@ -1,125 +1,943 @@
+#define _GNU_SOURCE // Para accept4 y pipe2
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
-#include <sys/wait.h> 
+#include <sys/wait.h>
 #include <signal.h>
 #include <string.h>
+#include <strings.h> // Para strcasecmp
 #include <ctype.h> // Necesario para tolower
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <getopt.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <stdint.h>
+#include <time.h>
+#include <spawn.h>
+#include <linux/sched.h> // struct clone_args, CLONE_PIDFD
 
-// Variable global para almacenar el PID (ID de Proceso) del hijo
-pid_t child_pid = 0; 
+#include "histograma.h"
 
-// Manejador de señal para SIGINT (Ctrl+C) en el proceso padre
-void handle_sigint_padre(int sig) {
-    printf("\nCtrl+C recibido por el padre.\n");
-    if (child_pid > 0) {
-        printf("Terminando proceso hijo (PID: %d) debido a Ctrl+C...\n", child_pid);
-        kill(child_pid, SIGKILL); // Envía SIGKILL para asegurar la terminación del hijo
-        waitpid(child_pid, NULL, 0); // Espera a que el hijo termine para evitar procesos zombie
-        printf("Proceso hijo terminado.\n");
-        child_pid = 0; 
+// Supervisor de procesos ./interface. Un solo lazo de eventos con epoll atiende
+// todo sin bloquearse en nada en particular:
+//   - signalfd: SIGINT y SIGTERM (terminar ordenadamente) y SIGCHLD, que avisa
+//     que algún hijo se detuvo o continuó; waitid() con WSTOPPED | WCONTINUED
+//     confirma cuál.
+//   - un pidfd por hijo: se vuelve legible cuando ese hijo termina y se lo
+//     recoge en el momento con waitid(P_PIDFD), sin zombies ni esperas.
+//   - la entrada estándar y, con -s, un socket Unix de control: cada línea es
+//     un comando y la respuesta vuelve por donde llegó.
+//
+// Comandos (mayúsculas o minúsculas):
+//   C [n] [grupo]  crea n hijos (por defecto 1), opcionalmente en un grupo
+//   S [destino]    detiene (SIGSTOP)
+//   G [destino]    continúa (SIGCONT)
+//   F [destino]    termina (SIGKILL) los hijos del destino; sin destino termina
+//                  todos los hijos y el supervisor
+//   L [destino]    lista los hijos y su estado
+//   A modo         cómo se crean los hijos desde ahora: fork, spawn o clone3
+//   R              latencias de cada operación hasta ahora
+// El destino es '*' (todos, también sin destino), un número de hijo, un rango
+// 'N-M' o el nombre de un grupo.
+//
+// Cada operación se mide desde el comando hasta que el kernel confirma el
+// cambio de estado: crear, hasta que el exec del hijo se completó; S y G, hasta
+// que waitid() informa CLD_STOPPED o CLD_CONTINUED; F, hasta que el pidfd
+// indica que el hijo terminó. Con -b los comandos salen de un guion y cada uno
+// espera sus confirmaciones antes del siguiente; -B arma ese guion solo, con
+// ciclos de crear, detener, continuar y finalizar, para cada modo de creación.
+//
+// Compilar: gcc -O2 -o main_controller main_controller.c
+// Uso típico: ./main_controller -s /tmp/control.sock -o /dev/null
+//             echo "C 200 trabajadores" | nc -U /tmp/control.sock
+// Banco:      ./main_controller -B 20 -n 100 -o /dev/null
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+#ifndef SYS_clone3
+#define SYS_clone3 435
+#endif
+
+#define TAM_GRUPO 24
+#define TAM_LINEA 512
+#define MAX_CONTROLES 64
+#define PLAZO_CONFIRMACION_MS 5000  // Guion: cuánto esperar las confirmaciones de un comando
+
+// La etiqueta de cada descriptor en epoll: el tipo en los bits altos, el índice
+// (de hijo o de conexión de control) en los bajos.
+#define TIPO_SENALES (1ULL << 32)
+#define TIPO_ENTRADA (2ULL << 32)
+#define TIPO_ESCUCHA (3ULL << 32)
+#define TIPO_CONTROL (4ULL << 32)
+#define TIPO_HIJO    (5ULL << 32)
+
+enum estado_hijo { HIJO_LIBRE, HIJO_CORRIENDO, HIJO_DETENIDO, HIJO_TERMINANDO };
+
+// Cómo se crea cada hijo (-a o el comando A):
+//   fork:   fork() + execlp(); el hijo copia la tabla de páginas del padre.
+//   spawn:  posix_spawnp(); glibc usa clone(CLONE_VM | CLONE_VFORK) y el padre
+//           sigue recién cuando el hijo hizo exec.
+//   clone3: clone3() con CLONE_VFORK | CLONE_PIDFD: el pidfd sale de la misma
+//           llamada, sin pidfd_open() aparte.
+enum arranque { ARRANQUE_FORK, ARRANQUE_SPAWN, ARRANQUE_CLONE3, NUM_ARRANQUES };
+
+const char *nombres_arranques[NUM_ARRANQUES] = { "fork", "spawn", "clone3" };
+
+enum operacion { OP_NINGUNA = -1, OP_CREAR, OP_DETENER, OP_CONTINUAR, OP_FINALIZAR, NUM_OPERACIONES };
+
+const char *nombres_operaciones[NUM_OPERACIONES] = { "crear", "detener", "continuar", "finalizar" };
+
+typedef struct {
+    enum estado_hijo estado;
+    int numero;                 // Identificador para los comandos, único en la sesión
+    pid_t pid;
+    int pidfd;                  // -1 si el kernel no tiene pidfd_open
+    char grupo[TAM_GRUPO];
+    enum arranque arranque;
+    enum operacion esperando;   // Operación enviada y todavía sin confirmar
+    uint64_t desde_ns;          // Cuándo se envió
+} hijo_t;
+
+// Conexión al socket de control, con la línea que todavía no se completó.
+typedef struct {
+    int fd;                     // -1: libre
+    char linea[TAM_LINEA];
+    size_t usado;
+} control_t;
+
+hijo_t *hijos = NULL;
+int capacidad_hijos = 0, hijos_activos = 0, proximo_numero = 1;
+int *libres = NULL, num_libres = 0;
+control_t controles[MAX_CONTROLES];
+
+int epoll_fd = -1, signal_fd = -1, escucha_fd = -1;
+const char *programa_hijo = "./interface";
+const char *salida_hijos = NULL;   // -o: a dónde van stdout y stderr de los hijos
+const char *ruta_control = NULL;
+int con_pidfd = 1;
+int terminar = 0;
+int silencioso = 0;                // -q: sin un aviso por hijo ni por comando del guion
+enum arranque arranque = ARRANQUE_FORK;
+
+// Latencias por modo de creación del hijo y por operación, en nanosegundos.
+histograma_t latencias[NUM_ARRANQUES][NUM_OPERACIONES];
+int pendientes = 0;                // Operaciones enviadas sin confirmar
+int confirmadas = 0;               // Confirmadas desde el último comando
+sigset_t mascara_original;         // La que heredan los hijos antes de exec
+
+// Descriptor por el que se responde el comando en curso (stdout o una conexión).
+int salida_comando = STDOUT_FILENO;
+
+void responder(const char *formato, ...) {
+    char texto[1024];
+    va_list args;
+    va_start(args, formato);
+    int n = vsnprintf(texto, sizeof(texto), formato, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(texto)) n = sizeof(texto) - 1;
+    if (salida_comando == STDOUT_FILENO) {
+        fputs(texto, stdout);
+        fflush(stdout);
+    } else {
+        // Una conexión de control que no lee no frena al supervisor: lo que no
+        // entra en su socket se pierde.
+        send(salida_comando, texto, n, MSG_DONTWAIT | MSG_NOSIGNAL);
     }
-    printf("Proceso padre terminando.\n");
-    exit(EXIT_SUCCESS); // El padre también termina
 }
 
-int main() {
-    char buffer_comando[32]; // Buffer para leer la entrada del usuario
+int pidfd_abrir(pid_t pid) {
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+}
 
-    // Configura el manejador de señal para SIGINT (Ctrl+C)
-    if (signal(SIGINT, handle_sigint_padre) == SIG_ERR) {
-        perror("Error: No se pudo establecer el manejador para SIGINT");
-        exit(EXIT_FAILURE);
+int registrar(int fd, uint64_t etiqueta) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = etiqueta };
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Ranura libre en la tabla de hijos; la tabla crece al doble cuando se llena.
+int reservar_hijo(void) {
+    if (num_libres == 0) {
+        int nueva = capacidad_hijos ? 2 * capacidad_hijos : 64;
+        hijo_t *h = realloc(hijos, nueva * sizeof(hijo_t));
+        int *l = realloc(libres, nueva * sizeof(int));
+        if (h == NULL || l == NULL) return -1;
+        hijos = h;
+        libres = l;
+        for (int i = nueva - 1; i >= capacidad_hijos; i--) {
+            hijos[i].estado = HIJO_LIBRE;
+            libres[num_libres++] = i;
+        }
+        capacidad_hijos = nueva;
     }
+    return libres[--num_libres];
+}
 
-    printf("Proceso Padre (PID: %d) iniciado.\n", getpid());
-    printf("Ingrese comando: 'C' (Crear), 'S' (Detener), 'G' (Continuar/Go), 'F' (Finalizar Padre e Hijo)\n");
+void liberar_hijo(int i) {
+    if (hijos[i].pidfd != -1) close(hijos[i].pidfd); // También lo quita de epoll
+    if (hijos[i].esperando != OP_NINGUNA) pendientes--;
+    hijos[i].estado = HIJO_LIBRE;
+    libres[num_libres++] = i;
+    hijos_activos--;
+}
 
-    while (1) {
-        printf("> ");
-        // Leer la entrada del usuario
-        if (fgets(buffer_comando, sizeof(buffer_comando), stdin) == NULL) {
-            // Manejar EOF (Ctrl+D)
-            printf("\nEOF detectado. Limpiando y saliendo.\n");
-            if (child_pid > 0) {
-                printf("Terminando proceso hijo (PID: %d)...\n", child_pid);
-                kill(child_pid, SIGKILL);
-                waitpid(child_pid, NULL, 0); 
+int buscar_pid(pid_t pid) {
+    for (int i = 0; i < capacidad_hijos; i++) {
+        if (hijos[i].estado != HIJO_LIBRE && hijos[i].pid == pid) return i;
+    }
+    return -1;
+}
+
+const char *nombre_estado(enum estado_hijo e) {
+    switch (e) {
+        case HIJO_CORRIENDO:  return "corriendo";
+        case HIJO_DETENIDO:   return "detenido";
+        case HIJO_TERMINANDO: return "terminando";
+        default:              return "libre";
+    }
+}
+
+uint64_t reloj_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// El hijo 'i' queda esperando la confirmación de 'op'. Si tenía otra pendiente
+// (p. ej. S y enseguida F), ésa ya no se mide.
+void esperar_confirmacion(int i, enum operacion op) {
+    if (hijos[i].esperando == OP_NINGUNA) pendientes++;
+    hijos[i].esperando = op;
+    hijos[i].desde_ns = reloj_ns();
+}
+
+// El kernel confirmó 'op' para el hijo 'i': se registra si era lo esperado.
+void confirmar(int i, enum operacion op) {
+    hijo_t *h = &hijos[i];
+    if (h->esperando == OP_NINGUNA) return;
+    if (h->esperando == op) {
+        histograma_registrar(&latencias[h->arranque][op], reloj_ns() - h->desde_ns);
+        confirmadas++;
+    }
+    h->esperando = OP_NINGUNA;
+    pendientes--;
+}
+
+// Lado del hijo con fork y clone3: vuelve a la máscara de señales original
+// (exec la conserva) y va a su propio grupo de procesos, así un Ctrl+C en la
+// terminal le llega sólo al supervisor, que decide qué hacer. Si exec falla,
+// avisa el errno por 'aviso' (que exec cierra si sale bien).
+void ejecutar_hijo(int aviso) {
+    sigprocmask(SIG_SETMASK, &mascara_original, NULL);
+    setpgid(0, 0);
+    if (salida_hijos != NULL) {
+        int fd = open(salida_hijos, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd != -1) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+    }
+    execlp(programa_hijo, programa_hijo, (char *)NULL);
+    int error = errno;
+    if (write(aviso, &error, sizeof(error)) < 0) {
+        // Nada que hacer: el padre ve fin de archivo y el hijo termina igual.
+    }
+    _exit(127);
+}
+
+// posix_spawnp con lo mismo que ejecutar_hijo() hace a mano.
+pid_t lanzar_spawn(void) {
+    posix_spawnattr_t atributos;
+    posix_spawn_file_actions_t acciones;
+    posix_spawnattr_init(&atributos);
+    posix_spawnattr_setflags(&atributos, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setsigmask(&atributos, &mascara_original);
+    posix_spawnattr_setpgroup(&atributos, 0);
+    posix_spawn_file_actions_init(&acciones);
+    if (salida_hijos != NULL) {
+        posix_spawn_file_actions_addopen(&acciones, STDOUT_FILENO, salida_hijos, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        posix_spawn_file_actions_adddup2(&acciones, STDOUT_FILENO, STDERR_FILENO);
+    }
+    char *const args[] = { (char *)programa_hijo, NULL };
+    pid_t pid;
+    int error = posix_spawnp(&pid, programa_hijo, &acciones, &atributos, args, environ);
+    posix_spawn_file_actions_destroy(&acciones);
+    posix_spawnattr_destroy(&atributos);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return pid;
+}
+
+// Lanza programa_hijo según 'arranque' y vuelve recién cuando el exec se
+// completó (o falló, con -1 y errno). En *pidfd deja el pidfd del hijo, o -1.
+pid_t lanzar(int *pidfd) {
+    *pidfd = -1;
+    if (arranque == ARRANQUE_SPAWN) {
+        pid_t pid = lanzar_spawn();
+        if (pid > 0 && con_pidfd) *pidfd = pidfd_abrir(pid);
+        return pid;
+    }
+    int aviso[2];
+    if (pipe2(aviso, O_CLOEXEC) == -1) return -1;
+    pid_t pid;
+    if (arranque == ARRANQUE_CLONE3) {
+        // Sin CLONE_VM el hijo tiene su copia de la memoria, como con fork, y
+        // CLONE_VFORK suspende al padre hasta el exec: no hace falta esperar
+        // el aviso para saber si salió bien, ya está en la tubería.
+        struct clone_args args;
+        memset(&args, 0, sizeof(args));
+        args.flags = CLONE_VFORK | CLONE_PIDFD;
+        args.pidfd = (uint64_t)(uintptr_t)pidfd;
+        args.exit_signal = SIGCHLD;
+        pid = (pid_t)syscall(SYS_clone3, &args, sizeof(args));
+    } else {
+        pid = fork();
+    }
+    if (pid == 0) ejecutar_hijo(aviso[1]);
+    int error = errno;
+    close(aviso[1]);
+    if (pid < 0) {
+        close(aviso[0]);
+        *pidfd = -1;
+        errno = error;
+        return -1;
+    }
+    // Fin de archivo: exec cerró la tubería. Un errno: exec falló.
+    ssize_t n;
+    while ((n = read(aviso[0], &error, sizeof(error))) == -1 && errno == EINTR) {
+    }
+    close(aviso[0]);
+    if (n > 0) {
+        if (*pidfd != -1) close(*pidfd);
+        *pidfd = -1;
+        waitpid(pid, NULL, 0);
+        errno = error;
+        return -1;
+    }
+    if (arranque == ARRANQUE_FORK && con_pidfd) *pidfd = pidfd_abrir(pid);
+    return pid;
+}
+
+// Crea un hijo que ejecuta programa_hijo; la latencia de crear va desde el
+// comando hasta que el exec del hijo se completó.
+int crear_hijo(const char *grupo) {
+    int i = reservar_hijo();
+    if (i == -1) {
+        responder("Error: sin memoria para más hijos.\n");
+        return -1;
+    }
+    uint64_t desde = reloj_ns();
+    int pidfd;
+    pid_t pid = lanzar(&pidfd);
+    if (pid < 0) {
+        responder("Error: no se pudo crear el hijo con %s: %s\n", nombres_arranques[arranque], strerror(errno));
+        libres[num_libres++] = i;
+        return -1;
+    }
+    histograma_registrar(&latencias[arranque][OP_CREAR], reloj_ns() - desde);
+    confirmadas++;
+    hijo_t *h = &hijos[i];
+    h->estado = HIJO_CORRIENDO;
+    h->numero = proximo_numero++;
+    h->pid = pid;
+    h->arranque = arranque;
+    h->esperando = OP_NINGUNA;
+    snprintf(h->grupo, sizeof(h->grupo), "%s", grupo != NULL ? grupo : "");
+    // Aunque el hijo ya haya terminado, sigue sin recoger: el pidfd vale igual.
+    h->pidfd = pidfd;
+    if (h->pidfd != -1 && registrar(h->pidfd, TIPO_HIJO | i) == -1) {
+        perror("Error: epoll_ctl pidfd");
+        close(h->pidfd);
+        h->pidfd = -1;
+    }
+    hijos_activos++;
+    return i;
+}
+
+// Destino de un comando: NULL, "*" o "todos" es todos; "N" un hijo; "N-M" un
+// rango de números; otra cosa, un grupo.
+int en_destino(const hijo_t *h, const char *destino) {
+    if (h->estado == HIJO_LIBRE) return 0;
+    if (destino == NULL || strcmp(destino, "*") == 0 || strcmp(destino, "todos") == 0) return 1;
+    if (isdigit((unsigned char)destino[0])) {
+        char *fin;
+        long desde = strtol(destino, &fin, 10), hasta = desde;
+        if (*fin == '-') hasta = strtol(fin + 1, &fin, 10);
+        if (*fin == '\0') return h->numero >= desde && h->numero <= hasta;
+    }
+    return strcmp(h->grupo, destino) == 0;
+}
+
+// Envía 'senal' a cada hijo del destino. El estado cambia cuando el kernel lo
+// confirma (SIGCHLD o el pidfd), no al enviar. Sólo se espera confirmación de
+// un cambio real: SIGSTOP a un hijo detenido o SIGCONT a uno que corre no
+// generan aviso.
+void senalar(const char *destino, int senal, const char *nombre, const char *accion) {
+    int enviados = 0;
+    enum operacion op = senal == SIGSTOP ? OP_DETENER : senal == SIGCONT ? OP_CONTINUAR : OP_FINALIZAR;
+    for (int i = 0; i < capacidad_hijos; i++) {
+        hijo_t *h = &hijos[i];
+        if (!en_destino(h, destino) || h->estado == HIJO_TERMINANDO) continue;
+        int cambia = op == OP_FINALIZAR || (op == OP_DETENER) == (h->estado == HIJO_CORRIENDO);
+        if (cambia) esperar_confirmacion(i, op);
+        if (kill(h->pid, senal) == -1) {
+            responder("Error: kill(%s) al hijo %d (PID: %d): %s\n", nombre, h->numero, h->pid,
+                      strerror(errno));
+            if (cambia) confirmar(i, OP_NINGUNA);
+            continue;
+        }
+        if (senal == SIGKILL) h->estado = HIJO_TERMINANDO;
+        enviados++;
+    }
+    if (silencioso) return;
+    if (enviados == 0) {
+        responder("No hay procesos hijos activos para %s%s%s.\n", accion, destino ? " en " : "",
+                  destino ? destino : "");
+    } else {
+        responder("Padre: %s enviado a %d hijo%s.\n", nombre, enviados, enviados == 1 ? "" : "s");
+    }
+}
+
+void listar(const char *destino) {
+    int n = 0;
+    for (int i = 0; i < capacidad_hijos; i++) {
+        const hijo_t *h = &hijos[i];
+        if (!en_destino(h, destino)) continue;
+        responder("  hijo %-5d PID %-7d %-10s %s\n", h->numero, h->pid, nombre_estado(h->estado), h->grupo);
+        n++;
+    }
+    responder("%d hijo%s (%d activos en total).\n", n, n == 1 ? "" : "s", hijos_activos);
+}
+
+void ayuda(void) {
+    responder("Comandos: 'C [n] [grupo]' (Crear), 'S [destino]' (Detener), 'G [destino]' (Continuar/Go),\n"
+              "          'F [destino]' (Finalizar; sin destino, también el padre), 'L [destino]' (Listar),\n"
+              "          'A fork|spawn|clone3' (modo de creación), 'R' (latencias).\n"
+              "Destino: '*' (todos), un número de hijo, un rango 'N-M' o un grupo.\n");
+}
+
+// Latencias de cada operación por modo de creación, desde el comando hasta la
+// confirmación del kernel. 'csv' da una fila por combinación con muestras.
+void reportar(int csv) {
+    if (csv) responder("arranque,operacion,n,media_us,p50_us,p99_us,p999_us,max_us\n");
+    else responder("%-7s %-10s %8s %10s %10s %10s %10s %10s\n", "modo", "operación", "n", "media us", "p50 us",
+                   "p99 us", "p99.9 us", "máx. us");
+    for (int a = 0; a < NUM_ARRANQUES; a++) {
+        for (int op = 0; op < NUM_OPERACIONES; op++) {
+            const histograma_t *h = &latencias[a][op];
+            if (h->total == 0) continue;
+            responder(csv ? "%s,%s,%lu,%.2f,%.2f,%.2f,%.2f,%.2f\n" : "%-7s %-10s %8lu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                      nombres_arranques[a], nombres_operaciones[op], (unsigned long)h->total,
+                      histograma_media(h) / 1e3, histograma_percentil(h, 0.50) / 1e3,
+                      histograma_percentil(h, 0.99) / 1e3, histograma_percentil(h, 0.999) / 1e3, h->maximo / 1e3);
+        }
+    }
+}
+
+void ejecutar_comando(char *linea) {
+    char *comando = strtok(linea, " \t\r\n");
+    if (comando == NULL) return;
+    char *arg1 = strtok(NULL, " \t\r\n"), *arg2 = strtok(NULL, " \t\r\n");
+    char comando_char = tolower((unsigned char)comando[0]);
+
+    switch (comando_char) {
+        case 'c': { // Crear procesos hijos
+            int n = 1;
+            const char *grupo = arg1;
+            if (arg1 != NULL && isdigit((unsigned char)arg1[0])) {
+                n = atoi(arg1);
+                grupo = arg2;
             }
-            break; 
-        }
-
-        buffer_comando[strcspn(buffer_comando, "\n")] = 0;
-
-        // Procesar solo si el comando no está vacío
-        if (strlen(buffer_comando) > 0) {
-            char comando_char = tolower(buffer_comando[0]); 
-
-            switch (comando_char) {
-                case 'c': // Crear proceso hijo
-                    if (child_pid != 0) {
-                        printf("El proceso hijo ya existe (PID: %d).\n", child_pid);
-                    } else {
-                        child_pid = fork(); // Crear un nuevo proceso
-
-                        if (child_pid < 0) {
-                            perror("Error: fork() falló");
-                            child_pid = 0; // Reiniciar en caso de fallo
-                        } else if (child_pid == 0) {
-                            // Este es el proceso hijo
-                            printf("Proceso hijo (PID: %d) creado. Ejecutando './interface'...\n", getpid());
-                            // Ejecutar el programa "interface"
-                            if (execlp("./interface", "interface", (char *)NULL) == -1) {
-                                perror("Hijo: Falló execlp() para ejecutar ./interface");
-                                exit(EXIT_FAILURE); // Si execlp falla, el hijo debe salir
-                            }
-                        } else {
-                            printf("Padre: Proceso hijo creado con PID: %d.\n", child_pid);
-                        }
-                    }
-                    break;
+            if (grupo != NULL && (isdigit((unsigned char)grupo[0]) || strcmp(grupo, "*") == 0 ||
+                                  strcmp(grupo, "todos") == 0)) {
+                responder("Grupo inválido: '%s' (no puede empezar con un dígito ni ser '*' o 'todos').\n", grupo);
+                break;
+            }
+            int creados = 0, primero = -1;
+            for (int k = 0; k < n; k++) {
+                int i = crear_hijo(grupo);
+                if (i == -1) break;
+                if (primero == -1) primero = i;
+                creados++;
+            }
+            if (!silencioso && creados == 1) {
+                responder("Padre: Proceso hijo %d creado con PID: %d.\n", hijos[primero].numero, hijos[primero].pid);
+            } else if (!silencioso && creados > 1) {
+                responder("Padre: %d procesos hijos creados (%d a %d)%s%s.\n", creados, hijos[primero].numero,
+                          proximo_numero - 1, grupo ? " en el grupo " : "", grupo ? grupo : "");
+            }
+            break;
+        }
+        case 's': // Detener procesos hijos
+            senalar(arg1, SIGSTOP, "SIGSTOP", "detener");
+            break;
+        case 'g': // Continuar procesos hijos
+            senalar(arg1, SIGCONT, "SIGCONT", "continuar");
+            break;
+        case 'f': // Finalizar hijos, y sin destino también el padre
+            if (arg1 == NULL) {
+                responder("Padre: Comando 'F' recibido. Terminando...\n");
+                terminar = 1;
+            } else {
+                senalar(arg1, SIGKILL, "SIGKILL", "finalizar");
+            }
+            break;
+        case 'l':
+            listar(arg1);
+            break;
+        case 'a': { // Modo de creación de los próximos hijos
+            int a = 0;
+            while (a < NUM_ARRANQUES && (arg1 == NULL || strcasecmp(arg1, nombres_arranques[a]) != 0)) a++;
+            if (a == NUM_ARRANQUES) {
+                responder("Modo desconocido: '%s'. Use fork, spawn o clone3.\n", arg1 ? arg1 : "");
+            } else {
+                arranque = a;
+                if (!silencioso) responder("Padre: los hijos se crean con %s.\n", nombres_arranques[a]);
+            }
+            break;
+        }
+        case 'r':
+            reportar(0);
+            break;
+        case 'h':
+        case '?':
+            ayuda();
+            break;
+        default:
+            responder("Comando desconocido: '%c'. Por favor use C, S, G, F, L, A o R.\n", comando_char);
+            break; // para solo utilizar los comandos especificados
+    }
+}
 
-                case 's': // Detener proceso hijo
-                    if (child_pid > 0) {
-                        printf("Padre: Enviando SIGSTOP al hijo (PID: %d).\n", child_pid);
-                        if (kill(child_pid, SIGSTOP) == -1) {
-                            perror("Error: kill(SIGSTOP) falló");
-                        }
-                    } else {
-                        printf("No hay proceso hijo activo para detener.\n");
-                    }
-                    break;
+// Ejecuta cada línea completa de 'buf' y deja al principio la incompleta.
+// Devuelve cuántos bytes quedaron sin procesar.
+size_t procesar_lineas(char *buf, size_t usado, int salida) {
+    size_t inicio = 0;
+    char *nl;
+    while ((nl = memchr(buf + inicio, '\n', usado - inicio)) != NULL) {
+        *nl = '\0';
+        salida_comando = salida;
+        ejecutar_comando(buf + inicio);
+        salida_comando = STDOUT_FILENO;
+        inicio = nl - buf + 1;
+    }
+    memmove(buf, buf + inicio, usado - inicio);
+    return usado - inicio;
+}
 
-                case 'g': // Continuar proceso hijo
-                    if (child_pid > 0) {
-                        printf("Padre: Enviando SIGCONT al hijo (PID: %d).\n", child_pid);
-                        if (kill(child_pid, SIGCONT) == -1) {
-                            perror("Error: kill(SIGCONT) falló");
-                        }
-                    } else {
-                        printf("No hay proceso hijo activo para continuar.\n");
-                    }
-                    break;
+void mostrar_prompt(void) {
+    if (isatty(STDIN_FILENO)) {
+        printf("> ");
+        fflush(stdout);
+    }
+}
 
-                case 'f': // Finalizar padre e hijo
-                    printf("Padre: Comando 'F' recibido. Terminando...\n");
-                    if (child_pid > 0) {
-                        printf("Terminando proceso hijo (PID: %d)...\n", child_pid);
-                        kill(child_pid, SIGKILL); 
-                        waitpid(child_pid, NULL, 0); 
-                        child_pid = 0;
-                    }
-                    printf("Proceso padre saliendo.\n");
-                    exit(EXIT_SUCCESS); // Terminar proceso padre
+// Reporta y recoge al hijo 'i' que terminó.
+void hijo_terminado(int i, const siginfo_t *info) {
+    hijo_t *h = &hijos[i];
+    confirmar(i, OP_FINALIZAR);
+    if (!silencioso) {
+        if (info->si_code == CLD_EXITED) {
+            printf("Hijo %d (PID: %d) terminó con código %d.\n", h->numero, h->pid, info->si_status);
+        } else {
+            printf("Hijo %d (PID: %d) terminó por la señal %s.\n", h->numero, h->pid, strsignal(info->si_status));
+        }
+    }
+    liberar_hijo(i);
+}
+
+// El pidfd del hijo 'i' está legible: terminó y se lo recoge ya.
+void recoger_hijo(int i) {
+    siginfo_t info;
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PIDFD, hijos[i].pidfd, &info, WEXITED | WNOHANG) == -1) {
+        if (errno == ECHILD) liberar_hijo(i); // Ya se recogió por otra vía
+        return;
+    }
+    if (info.si_pid != 0) hijo_terminado(i, &info);
+}
+
+// SIGCHLD: algún hijo se detuvo, continuó o (sin pidfd) terminó.
+void cambios_de_estado(void) {
+    int opciones = WSTOPPED | WCONTINUED | WNOHANG | (con_pidfd ? 0 : WEXITED);
+    for (;;) {
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_ALL, 0, &info, opciones) == -1 || info.si_pid == 0) return;
+        int i = buscar_pid(info.si_pid);
+        if (i == -1) continue;
+        hijo_t *h = &hijos[i];
+        switch (info.si_code) {
+            case CLD_STOPPED:
+                if (h->estado != HIJO_TERMINANDO) h->estado = HIJO_DETENIDO;
+                confirmar(i, OP_DETENER);
+                if (!silencioso) printf("Hijo %d (PID: %d) detenido.\n", h->numero, h->pid);
+                break;
+            case CLD_CONTINUED:
+                if (h->estado != HIJO_TERMINANDO) h->estado = HIJO_CORRIENDO;
+                confirmar(i, OP_CONTINUAR);
+                if (!silencioso) printf("Hijo %d (PID: %d) continúa.\n", h->numero, h->pid);
+                break;
+            default:
+                hijo_terminado(i, &info);
+        }
+    }
+}
+
+void leer_senales(void) {
+    struct signalfd_siginfo si;
+    while (read(signal_fd, &si, sizeof(si)) == sizeof(si)) {
+        if (si.ssi_signo == SIGCHLD) {
+            cambios_de_estado();
+        } else {
+            printf("\n%s recibido por el padre.\n", strsignal(si.ssi_signo));
+            terminar = 1;
+        }
+    }
+}
+
+void aceptar_control(void) {
+    int fd;
+    while ((fd = accept4(escucha_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        int k = 0;
+        while (k < MAX_CONTROLES && controles[k].fd != -1) k++;
+        if (k == MAX_CONTROLES || registrar(fd, TIPO_CONTROL | k) == -1) {
+            send(fd, "Demasiadas conexiones de control.\n", 34, MSG_DONTWAIT | MSG_NOSIGNAL);
+            close(fd);
+            continue;
+        }
+        controles[k].fd = fd;
+        controles[k].usado = 0;
+    }
+}
+
+void leer_control(int k) {
+    control_t *c = &controles[k];
+    ssize_t n;
+    while ((n = read(c->fd, c->linea + c->usado, sizeof(c->linea) - 1 - c->usado)) > 0) {
+        c->usado = procesar_lineas(c->linea, c->usado + n, c->fd);
+        if (c->usado == sizeof(c->linea) - 1) c->usado = 0; // Línea demasiado larga: se descarta
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+        // Una última línea sin '\n' también es un comando.
+        if (c->usado > 0) {
+            c->linea[c->usado++] = '\n';
+            procesar_lineas(c->linea, c->usado, c->fd);
+        }
+        close(c->fd);
+        c->fd = -1;
+    }
+}
+
+// La entrada estándar sólo se lee cuando epoll dice que hay algo: una read()
+// que no bloquea, sin poner la terminal en modo no bloqueante. Devuelve 0 en
+// fin de archivo.
+char linea_entrada[TAM_LINEA];
+size_t usado_entrada = 0;
+
+int leer_entrada(void) {
+    ssize_t n = read(STDIN_FILENO, linea_entrada + usado_entrada, sizeof(linea_entrada) - 1 - usado_entrada);
+    if (n == -1) return errno == EINTR || errno == EAGAIN;
+    if (n == 0) {
+        if (usado_entrada > 0) {
+            linea_entrada[usado_entrada++] = '\n';
+            usado_entrada = procesar_lineas(linea_entrada, usado_entrada, STDOUT_FILENO);
+        }
+        return 0;
+    }
+    usado_entrada = procesar_lineas(linea_entrada, usado_entrada + n, STDOUT_FILENO);
+    if (usado_entrada == sizeof(linea_entrada) - 1) usado_entrada = 0;
+    if (!terminar) mostrar_prompt();
+    return 1;
+}
+
+// Fin de la entrada estándar, sea terminal, tubería o archivo: se deja de
+// leerla y, sin socket de control, es fin del supervisor (y de sus hijos).
+void cerrar_entrada(int registrada) {
+    if (registrada) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+    if (escucha_fd == -1) {
+        printf("\nEOF detectado. Limpiando y saliendo.\n");
+        terminar = 1;
+    }
+}
+
+int abrir_control(const char *ruta) {
+    struct sockaddr_un direccion = { .sun_family = AF_UNIX };
+    if (strlen(ruta) >= sizeof(direccion.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(direccion.sun_path, ruta);
+    unlink(ruta);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1 || bind(fd, (struct sockaddr *)&direccion, sizeof(direccion)) == -1 || listen(fd, 16) == -1) {
+        return -1;
+    }
+    return fd;
+}
+
+// Termina a todos los hijos (también a los detenidos: SIGKILL no espera a
+// SIGCONT) y los recoge antes de salir.
+void terminar_hijos(void) {
+    for (int i = 0; i < capacidad_hijos; i++) {
+        hijo_t *h = &hijos[i];
+        if (h->estado == HIJO_LIBRE) continue;
+        if (!silencioso) printf("Terminando proceso hijo %d (PID: %d)...\n", h->numero, h->pid);
+        kill(h->pid, SIGKILL);
+    }
+    for (int i = 0; i < capacidad_hijos; i++) {
+        if (hijos[i].estado == HIJO_LIBRE) continue;
+        waitpid(hijos[i].pid, NULL, 0);
+        liberar_hijo(i);
+    }
+}
+
+// Guion (-b o -B): un comando por vez, el siguiente recién cuando llegaron
+// todas las confirmaciones del anterior (o venció PLAZO_CONFIRMACION_MS).
+FILE *guion = NULL;
+char comando_guion[TAM_LINEA];
+uint64_t inicio_comando = 0;
+int comando_en_curso = 0;
 
-                default:
-                    printf("Comando desconocido: '%c'. Por favor use C, S, G, o F.\n", comando_char);
-                    break; // para solo utilizar los comandos especificados
+// Cierra el comando en curso y ejecuta el siguiente. Devuelve 0 al terminar el guion.
+int avanzar_guion(void) {
+    if (comando_en_curso && !silencioso) {
+        printf("Guion: '%s': %d confirmaciones en %.3f ms\n", comando_guion, confirmadas,
+               (reloj_ns() - inicio_comando) / 1e6);
+    }
+    comando_en_curso = 0;
+    char linea[TAM_LINEA];
+    while (fgets(linea, sizeof(linea), guion) != NULL) {
+        linea[strcspn(linea, "\r\n")] = '\0';
+        char *inicio = linea + strspn(linea, " \t");
+        if (*inicio == '\0' || *inicio == '#') continue;
+        snprintf(comando_guion, sizeof(comando_guion), "%s", inicio);
+        confirmadas = 0;
+        comando_en_curso = 1;
+        inicio_comando = reloj_ns();
+        ejecutar_comando(inicio);
+        return 1;
+    }
+    return 0;
+}
+
+// Las confirmaciones que faltan no van a llegar: se dejan de esperar.
+void abandonar_pendientes(void) {
+    printf("Guion: '%s': %d confirmaciones no llegaron en %d ms\n", comando_guion, pendientes,
+           PLAZO_CONFIRMACION_MS);
+    for (int i = 0; i < capacidad_hijos; i++) {
+        if (hijos[i].estado != HIJO_LIBRE) hijos[i].esperando = OP_NINGUNA;
+    }
+    pendientes = 0;
+}
+
+// Arma el guion del banco: por cada modo, 'ciclos' veces crear 'n' hijos,
+// detenerlos, continuarlos y terminarlos.
+FILE *guion_banco(int ciclos, int n, int solo_modo) {
+    FILE *f = tmpfile();
+    if (f == NULL) return NULL;
+    for (int a = 0; a < NUM_ARRANQUES; a++) {
+        if (solo_modo != -1 && a != solo_modo) continue;
+        fprintf(f, "A %s\n", nombres_arranques[a]);
+        for (int c = 0; c < ciclos; c++) fprintf(f, "C %d\nS\nG\nF *\n", n);
+    }
+    rewind(f);
+    return f;
+}
+
+void uso(const char *programa) {
+    fprintf(stderr, "Uso: %s [-s socket] [-o salida] [-x programa] [-a fork|spawn|clone3]\n"
+                    "          [-b guion | -B ciclos [-n hijos]] [-q] [-F texto|csv]\n", programa);
+    fprintf(stderr, "  -s  también acepta comandos en este socket Unix\n");
+    fprintf(stderr, "  -o  archivo para la salida de los hijos (p. ej. /dev/null con muchos hijos)\n");
+    fprintf(stderr, "  -x  programa que ejecuta cada hijo (por defecto ./interface)\n");
+    fprintf(stderr, "  -a  cómo se crean los hijos (por defecto fork; también el comando A)\n");
+    fprintf(stderr, "  -b  ejecuta los comandos de este archivo ('-': la entrada estándar), cada uno\n"
+                    "      después de confirmado el anterior, y reporta las latencias al final\n");
+    fprintf(stderr, "  -B  banco: 'ciclos' veces C n, S, G, F * con cada modo (o sólo el de -a)\n");
+    fprintf(stderr, "  -n  hijos por ciclo del banco (por defecto 100)\n");
+    fprintf(stderr, "  -q  sin avisos por hijo ni por comando\n");
+    fprintf(stderr, "  -F  formato del reporte de latencias (por defecto texto)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opcion, ciclos_banco = 0, hijos_banco = 100, solo_modo = -1, csv = 0;
+    const char *ruta_guion = NULL;
+    while ((opcion = getopt(argc, argv, "s:o:x:a:b:B:n:qF:h")) != -1) {
+        switch (opcion) {
+            case 's': ruta_control = optarg; break;
+            case 'o': salida_hijos = optarg; break;
+            case 'x': programa_hijo = optarg; break;
+            case 'a':
+                for (solo_modo = NUM_ARRANQUES - 1; solo_modo >= 0; solo_modo--) {
+                    if (strcmp(optarg, nombres_arranques[solo_modo]) == 0) break;
+                }
+                if (solo_modo == -1) {
+                    fprintf(stderr, "Modo desconocido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                arranque = solo_modo;
+                break;
+            case 'b': ruta_guion = optarg; break;
+            case 'B': ciclos_banco = atoi(optarg); break;
+            case 'n': hijos_banco = atoi(optarg); break;
+            case 'q': silencioso = 1; break;
+            case 'F':
+                if (strcmp(optarg, "csv") == 0) {
+                    csv = 1;
+                } else if (strcmp(optarg, "texto") != 0) {
+                    fprintf(stderr, "Formato desconocido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'h': uso(argv[0]); return EXIT_SUCCESS;
+            default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (ciclos_banco < 0 || hijos_banco < 1 || (ciclos_banco > 0 && ruta_guion != NULL)) {
+        uso(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (ciclos_banco > 0) {
+        // Miles de "Time: N" de los hijos no dicen nada en un banco.
+        silencioso = 1;
+        if (salida_hijos == NULL) salida_hijos = "/dev/null";
+        if ((guion = guion_banco(ciclos_banco, hijos_banco, solo_modo)) == NULL) {
+            perror("tmpfile");
+            return EXIT_FAILURE;
+        }
+    } else if (ruta_guion != NULL) {
+        guion = strcmp(ruta_guion, "-") == 0 ? stdin : fopen(ruta_guion, "r");
+        if (guion == NULL) {
+            perror(ruta_guion);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Las señales se atienden como eventos: bloqueadas, llegan por el signalfd.
+    sigset_t senales;
+    sigemptyset(&senales);
+    sigaddset(&senales, SIGINT);
+    sigaddset(&senales, SIGTERM);
+    sigaddset(&senales, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &senales, &mascara_original) == -1 ||
+        (signal_fd = signalfd(-1, &senales, SFD_NONBLOCK | SFD_CLOEXEC)) == -1 ||
+        (epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1 || registrar(signal_fd, TIPO_SENALES) == -1) {
+        perror("Error: no se pudo preparar el lazo de eventos");
+        exit(EXIT_FAILURE);
+    }
+    for (int k = 0; k < MAX_CONTROLES; k++) controles[k].fd = -1;
+
+    // Un pidfd por hijo: con cientos de hijos hace falta subir el límite blando.
+    struct rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+        limite.rlim_cur = limite.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+    int prueba = pidfd_abrir(getpid());
+    if (prueba == -1) {
+        fprintf(stderr, "pidfd_open no disponible (%s): los hijos se recogen con SIGCHLD\n", strerror(errno));
+        con_pidfd = 0;
+    } else {
+        close(prueba);
+    }
+
+    if (ruta_control != NULL) {
+        if ((escucha_fd = abrir_control(ruta_control)) == -1 || registrar(escucha_fd, TIPO_ESCUCHA) == -1) {
+            perror(ruta_control);
+            exit(EXIT_FAILURE);
+        }
+    }
+    // Una entrada que no es terminal ni tubería (un archivo) no admite epoll:
+    // siempre está lista, así que se lee en cada vuelta sin esperar. Con un
+    // guion los comandos salen sólo de él (y del socket de control).
+    int entrada_abierta = guion == NULL, entrada_siempre_lista = 0;
+    if (entrada_abierta && registrar(STDIN_FILENO, TIPO_ENTRADA) == -1) {
+        if (errno != EPERM) {
+            perror("Error: epoll_ctl stdin");
+            exit(EXIT_FAILURE);
+        }
+        entrada_siempre_lista = 1;
+    }
+
+    if (guion == NULL) {
+        printf("Proceso Padre (PID: %d) iniciado.\n", getpid());
+        if (ruta_control != NULL) printf("Comandos también en el socket %s.\n", ruta_control);
+        ayuda();
+        mostrar_prompt();
+    } else if (ciclos_banco > 0 && !csv) {
+        printf("Banco: %d ciclos de C %d, S, G, F * por modo de creación, con %s\n", ciclos_banco, hijos_banco,
+               programa_hijo);
+    }
+
+    struct epoll_event eventos[64];
+    while (!terminar) {
+        if (entrada_siempre_lista && entrada_abierta && !leer_entrada()) {
+            entrada_abierta = 0;
+            cerrar_entrada(0);
+        }
+        if (guion != NULL && pendientes == 0 && !avanzar_guion()) break;
+        int espera = entrada_siempre_lista && entrada_abierta ? 0 : -1;
+        if (guion != NULL) espera = pendientes > 0 ? PLAZO_CONFIRMACION_MS : 0;
+        if (terminar) break;
+        int n = epoll_wait(epoll_fd, eventos, 64, espera);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("Error: epoll_wait");
+            break;
+        }
+        if (n == 0 && guion != NULL && pendientes > 0) abandonar_pendientes();
+        for (int k = 0; k < n && !terminar; k++) {
+            uint64_t etiqueta = eventos[k].data.u64;
+            uint32_t indice = (uint32_t)etiqueta;
+            switch (etiqueta & ~0xffffffffULL) {
+                case TIPO_SENALES:
+                    leer_senales();
+                    break;
+                case TIPO_ENTRADA:
+                    if (!leer_entrada()) {
+                        entrada_abierta = 0;
+                        cerrar_entrada(1);
+                    }
+                    break;
+                case TIPO_ESCUCHA:
+                    aceptar_control();
+                    break;
+                case TIPO_CONTROL:
+                    leer_control(indice);
+                    break;
+                case TIPO_HIJO:
+                    if (hijos[indice].estado != HIJO_LIBRE) recoger_hijo(indice);
+                    break;
             }
         }
+        fflush(stdout);
     }
 
-    printf("Proceso padre finalizado.\n");
+    terminar_hijos();
+    for (int k = 0; k < MAX_CONTROLES; k++) {
+        if (controles[k].fd != -1) close(controles[k].fd);
+    }
+    if (escucha_fd != -1) {
+        close(escucha_fd);
+        unlink(ruta_control);
+    }
+    if (guion != NULL) {
+        reportar(csv);
+        if (guion != stdin) fclose(guion);
+    } else {
+        printf("Proceso padre finalizado.\n");
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,103 @@
+#ifndef NOTIFICACION_H
+#define NOTIFICACION_H
+
+// Eventos entre procesos para despertar a una etapa sin señales.
+// Un evento es un contador que vive en memoria compartida: quien notifica lo
+// incrementa y quien espera se bloquea hasta que cambie respecto del valor que
+// observó. Sólo se hace una llamada al sistema cuando hay alguien dormido.
+//
+// Modos de bloqueo:
+//   NOTIFICACION_FUTEX:   futex(2) sobre el propio contador (sin descriptores).
+//   NOTIFICACION_EVENTFD: eventfd(2) creado antes del fork() y heredado.
+//   NOTIFICACION_GIRO:    nunca duerme, cede la CPU con sched_yield().
+// En FUTEX y EVENTFD se puede girar 'giros' iteraciones antes de dormir.
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+enum notificacion { NOTIFICACION_FUTEX, NOTIFICACION_EVENTFD, NOTIFICACION_GIRO };
+
+typedef struct {
+    _Alignas(64) _Atomic uint32_t valor;  // Palabra del futex
+    _Atomic uint32_t esperando;           // Procesos dormidos o a punto de dormir
+    enum notificacion modo;
+    int giros;
+    int fd;                               // NOTIFICACION_EVENTFD
+} evento_t;
+
+static inline void pausa_cpu(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Debe llamarse antes del fork() para que el eventfd se herede.
+static inline int evento_iniciar(evento_t *e, enum notificacion modo, int giros) {
+    atomic_store(&e->valor, 0);
+    atomic_store(&e->esperando, 0);
+    e->modo = modo;
+    e->giros = giros;
+    e->fd = -1;
+    if (modo == NOTIFICACION_EVENTFD) {
+        e->fd = eventfd(0, 0);
+        if (e->fd == -1) return -1;
+    }
+    return 0;
+}
+
+static inline void evento_destruir(evento_t *e) {
+    if (e->fd != -1) close(e->fd);
+    e->fd = -1;
+}
+
+static inline uint32_t evento_valor(evento_t *e) {
+    return atomic_load_explicit(&e->valor, memory_order_acquire);
+}
+
+static inline void evento_notificar(evento_t *e) {
+    // El incremento (seq_cst) y la lectura de 'esperando' forman la mitad de un
+    // Dekker con evento_esperar: o el que espera ve el nuevo valor, o aquí se
+    // ve que hay alguien esperando y se le despierta.
+    atomic_fetch_add(&e->valor, 1);
+    if (atomic_load(&e->esperando) == 0) return;
+    if (e->modo == NOTIFICACION_FUTEX) {
+        syscall(SYS_futex, &e->valor, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    } else if (e->modo == NOTIFICACION_EVENTFD) {
+        uint64_t uno = 1;
+        while (write(e->fd, &uno, sizeof(uno)) == -1 && errno == EINTR)
+            ;
+    }
+}
+
+// Bloquea hasta que el valor del evento deje de ser 'visto'. Puede volver
+// antes de tiempo (despertar espurio); el llamador revisa su condición.
+static inline void evento_esperar(evento_t *e, uint32_t visto) {
+    for (int i = 0; i < e->giros; i++) {
+        if (evento_valor(e) != visto) return;
+        pausa_cpu();
+    }
+    if (e->modo == NOTIFICACION_GIRO) {
+        while (evento_valor(e) == visto) sched_yield();
+        return;
+    }
+    atomic_fetch_add(&e->esperando, 1);
+    if (atomic_load(&e->valor) == visto) {
+        if (e->modo == NOTIFICACION_FUTEX) {
+            syscall(SYS_futex, &e->valor, FUTEX_WAIT, visto, NULL, NULL, 0);
+        } else {
+            uint64_t cuenta;
+            while (read(e->fd, &cuenta, sizeof(cuenta)) == -1 && errno == EINTR)
+                ;
+        }
+    }
+    atomic_fetch_sub(&e->esperando, 1);
+}
+
+#endif
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "histograma.h"
+
+// Productores concurrentes para el frontal de ./server --escuchar: abre N
+// conexiones al socket Unix, reparte entre ellas las líneas de un archivo (la
+// conexión c envía las líneas c, c + N, c + 2N...) y en cada una mantiene hasta
+// P pedidos sin responder. Verifica cada respuesta, que debe ser la línea
+// invertida o una marca de descarte o rechazo, y reporta mensajes/s y la
+// latencia de ida y vuelta vista desde el productor.
+//
+// Compilar: gcc -O2 -o productores productores.c
+// Uso típico: ./server -f -p64 --escuchar /tmp/so_l2.sock &
+//             ./productores -c 1000 -p 4 /tmp/so_l2.sock archivo.txt
+//             kill -INT %1
+
+#define ENTRADA_CONEXION 8192
+#define MAX_PEDIDOS 64
+
+typedef struct {
+    const char *texto;
+    size_t longitud;
+} linea_t;
+
+typedef struct {
+    int fd;
+    size_t siguiente;               // Próxima línea a enviar (índice global)
+    size_t pedidos[MAX_PEDIDOS];    // Líneas sin respuesta, en orden
+    uint64_t enviado_ns[MAX_PEDIDOS];
+    int primero, num_pedidos;
+    char *salida;                   // Pedidos preparados que no salieron todavía
+    size_t salida_inicio, salida_fin, tam_salida;
+    char entrada[ENTRADA_CONEXION];
+    size_t entrada_fin;
+    int cerrada_escritura;
+} conexion_t;
+
+linea_t *lineas = NULL;
+size_t num_lineas = 0;
+int num_conexiones = 1, profundidad = 1;
+unsigned long respondidos = 0, errores = 0, descartados = 0, rechazados = 0;
+histograma_t latencias;
+
+uint64_t reloj_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Carga el archivo completo y lo parte en líneas no vacías.
+int cargar_lineas(const char *ruta) {
+    FILE *f = fopen(ruta, "r");
+    if (f == NULL) {
+        perror(ruta);
+        return -1;
+    }
+    char *linea = NULL;
+    size_t tam = 0, capacidad = 0;
+    ssize_t n;
+    while ((n = getline(&linea, &tam, f)) != -1) {
+        if (n > 0 && linea[n - 1] == '\n') n--;
+        if (n == 0) continue;
+        if (n >= ENTRADA_CONEXION / 2) {
+            fprintf(stderr, "%s: línea %zu demasiado larga para el frontal\n", ruta, num_lineas + 1);
+            return -1;
+        }
+        if (num_lineas == capacidad) {
+            capacidad = capacidad ? 2 * capacidad : 4096;
+            if ((lineas = realloc(lineas, capacidad * sizeof(linea_t))) == NULL) {
+                perror("realloc");
+                return -1;
+            }
+        }
+        char *texto = malloc(n);
+        if (texto == NULL) {
+            perror("malloc");
+            return -1;
+        }
+        memcpy(texto, linea, n);
+        lineas[num_lineas].texto = texto;
+        lineas[num_lineas].longitud = n;
+        num_lineas++;
+    }
+    free(linea);
+    fclose(f);
+    return 0;
+}
+
+// Prepara pedidos hasta tener 'profundidad' sin respuesta y envía lo que pueda.
+// Devuelve -1 si la conexión falló.
+int enviar(conexion_t *c) {
+    while (c->num_pedidos < profundidad && c->siguiente < num_lineas) {
+        const linea_t *l = &lineas[c->siguiente];
+        if (c->salida_fin + l->longitud + 1 > c->tam_salida) {
+            memmove(c->salida, c->salida + c->salida_inicio, c->salida_fin - c->salida_inicio);
+            c->salida_fin -= c->salida_inicio;
+            c->salida_inicio = 0;
+            if (c->salida_fin + l->longitud + 1 > c->tam_salida) break;
+        }
+        memcpy(c->salida + c->salida_fin, l->texto, l->longitud);
+        c->salida[c->salida_fin + l->longitud] = '\n';
+        c->salida_fin += l->longitud + 1;
+        int k = (c->primero + c->num_pedidos) % MAX_PEDIDOS;
+        c->pedidos[k] = c->siguiente;
+        c->enviado_ns[k] = reloj_ns();
+        c->num_pedidos++;
+        c->siguiente += num_conexiones;
+    }
+    while (c->salida_inicio < c->salida_fin) {
+        ssize_t r = send(c->fd, c->salida + c->salida_inicio, c->salida_fin - c->salida_inicio, MSG_NOSIGNAL);
+        if (r >= 0) {
+            c->salida_inicio += r;
+        } else if (errno == EAGAIN) {
+            return 0; // Sigue con EPOLLOUT
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+    // Sin más líneas: se avisa el fin, el servidor cierra al responder todo.
+    if (c->siguiente >= num_lineas && !c->cerrada_escritura) {
+        shutdown(c->fd, SHUT_WR);
+        c->cerrada_escritura = 1;
+    }
+    return 0;
+}
+
+// Compara una respuesta con el pedido más antiguo de la conexión.
+void verificar(conexion_t *c, const char *respuesta, size_t n) {
+    if (c->num_pedidos == 0) {
+        errores++;
+        return;
+    }
+    int k = c->primero;
+    const linea_t *l = &lineas[c->pedidos[k]];
+    c->primero = (c->primero + 1) % MAX_PEDIDOS;
+    c->num_pedidos--;
+    respondidos++;
+    histograma_registrar(&latencias, reloj_ns() - c->enviado_ns[k]);
+    if (n == 11 && memcmp(respuesta, "!descartado", 11) == 0) {
+        descartados++;
+        return;
+    }
+    if (n == 10 && memcmp(respuesta, "!rechazado", 10) == 0) {
+        rechazados++;
+        return;
+    }
+    // encrypt -> reverse -> decrypt: la respuesta es la línea invertida.
+    int coincide = n == l->longitud;
+    for (size_t i = 0; coincide && i < n; i++) coincide = respuesta[i] == l->texto[n - 1 - i];
+    if (!coincide) errores++;
+}
+
+// Lee respuestas hasta vaciar el socket. Devuelve 1 si el servidor cerró, 0 si
+// sigue abierta y -1 ante un error.
+int recibir(conexion_t *c) {
+    for (;;) {
+        ssize_t r = read(c->fd, c->entrada + c->entrada_fin, ENTRADA_CONEXION - c->entrada_fin);
+        if (r == 0) return 1;
+        if (r == -1) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN ? 0 : -1;
+        }
+        c->entrada_fin += r;
+        size_t inicio = 0;
+        char *nl;
+        while ((nl = memchr(c->entrada + inicio, '\n', c->entrada_fin - inicio)) != NULL) {
+            verificar(c, c->entrada + inicio, nl - (c->entrada + inicio));
+            inicio = nl - c->entrada + 1;
+        }
+        memmove(c->entrada, c->entrada + inicio, c->entrada_fin - inicio);
+        c->entrada_fin -= inicio;
+    }
+}
+
+void uso(const char *programa) {
+    fprintf(stderr, "Uso: %s [-c conexiones] [-p pedidos] socket archivo\n", programa);
+    fprintf(stderr, "  -c  conexiones simultáneas (por defecto 1)\n");
+    fprintf(stderr, "  -p  pedidos sin responder por conexión (por defecto 1, máx. %d)\n", MAX_PEDIDOS);
+}
+
+int main(int argc, char *argv[]) {
+    int opcion;
+    while ((opcion = getopt(argc, argv, "c:p:h")) != -1) {
+        switch (opcion) {
+            case 'c': num_conexiones = atoi(optarg); break;
+            case 'p': profundidad = atoi(optarg); break;
+            case 'h': uso(argv[0]); return EXIT_SUCCESS;
+            default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 2 || num_conexiones < 1 || profundidad < 1 || profundidad > MAX_PEDIDOS) {
+        uso(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (cargar_lineas(argv[optind + 1]) == -1) return EXIT_FAILURE;
+    histograma_iniciar(&latencias);
+
+    struct rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < (rlim_t)num_conexiones + 16) {
+        limite.rlim_cur = limite.rlim_max < (rlim_t)num_conexiones + 16 ? limite.rlim_max
+                                                                        : (rlim_t)num_conexiones + 16;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+    struct sockaddr_un direccion = { .sun_family = AF_UNIX };
+    if (strlen(argv[optind]) >= sizeof(direccion.sun_path)) {
+        fprintf(stderr, "%s: ruta demasiado larga\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+    strcpy(direccion.sun_path, argv[optind]);
+
+    int epoll = epoll_create1(0);
+    conexion_t *conexiones = calloc(num_conexiones, sizeof(conexion_t));
+    if (epoll == -1 || conexiones == NULL) {
+        perror("productores");
+        return EXIT_FAILURE;
+    }
+    uint64_t inicio = reloj_ns();
+    // El connect() es bloqueante: si el servidor dejó de aceptar por falta de
+    // ranuras, se espera en su cola de listen().
+    for (int i = 0; i < num_conexiones; i++) {
+        conexion_t *c = &conexiones[i];
+        c->siguiente = i;
+        c->tam_salida = (size_t)profundidad * (ENTRADA_CONEXION / 2);
+        if ((c->salida = malloc(c->tam_salida)) == NULL ||
+            (c->fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+            connect(c->fd, (struct sockaddr *)&direccion, sizeof(direccion)) == -1) {
+            fprintf(stderr, "productores: conexión %d: %s\n", i, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLET, .data.ptr = c };
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, c->fd, &ev) == -1 || enviar(c) == -1) {
+            fprintf(stderr, "productores: conexión %d: %s\n", i, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    uint64_t conectadas = reloj_ns();
+
+    int abiertas = num_conexiones;
+    unsigned long fallidas = 0;
+    struct epoll_event eventos[256];
+    while (abiertas > 0) {
+        int n = epoll_wait(epoll, eventos, 256, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return EXIT_FAILURE;
+        }
+        for (int k = 0; k < n; k++) {
+            conexion_t *c = eventos[k].data.ptr;
+            if (c->fd == -1) continue;
+            int r = recibir(c);
+            if (r == 0 && enviar(c) == 0) continue;
+            // El servidor cerró (o falló): lo que quedó sin respuesta se perdió.
+            if (r == -1 || c->num_pedidos > 0 || c->siguiente < num_lineas) fallidas++;
+            close(c->fd);
+            c->fd = -1;
+            abiertas--;
+        }
+    }
+    double segundos = (reloj_ns() - inicio) / 1e9;
+
+    printf("Productores: %d conexiones (%.3f s en conectar), %d pedidos en vuelo por conexión\n",
+           num_conexiones, (conectadas - inicio) / 1e9, profundidad);
+    printf("Productores: %lu respuestas en %.3f s, %.0f mensajes/s; %lu descartadas, %lu rechazadas, "
+           "%lu no coinciden, %lu conexiones cortadas\n",
+           respondidos, segundos, segundos > 0 ? respondidos / segundos : 0.0, descartados, rechazados, errores,
+           fallidas);
+    printf("Productores: latencia us media %.1f, p50 %.1f, p99 %.1f, p99.9 %.1f, máx. %.1f\n",
+           histograma_media(&latencias) / 1e3, histograma_percentil(&latencias, 0.50) / 1e3,
+           histograma_percentil(&latencias, 0.99) / 1e3, histograma_percentil(&latencias, 0.999) / 1e3,
+           latencias.maximo / 1e3);
+    return errores == 0 && fallidas == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE // Para F_GETPIPE_SZ
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,8 +7,36 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <signal.h>
 #include <errno.h> // Para EEXIST
+#include <getopt.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/prctl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/vfs.h>
+#include <sys/syscall.h>
+#include <mntent.h>
+#include <linux/mempolicy.h>
+
+#include "anillo.h"
+#include "notificacion.h"
+#include "transformaciones.h"
+#include "histograma.h"
+#include "estadisticas.h"
+#include "fusion.h"
+#include "crc32c.h"
+#include "uring.h"
+#include "bitacora.h"
 
 // Definición de las tuberías con nombre
 #define FIFO_MESSAGE "fifo_message"
@@ -15,78 +44,3988 @@
 #define FIFO_DECRYPT "fifo_decrypt"
 #define FIFO_RESULT "fifo_result"
 
-// Tamaño máximo del buffer para las cadenas
-#define BUFFER_SIZE 256
+// Tamaño máximo del buffer para las cadenas
+#define BUFFER_SIZE 256
+
+// PIDs de los procesos hijos
+pid_t client1_pid, client2_pid, client3_pid;
+
+// Sincronización Servidor <-> Clientes con eventos en memoria compartida
+// (notificacion.h) en lugar de SIGUSR1/pause(): inicio[i] lo notifica el
+// servidor para que arranque el cliente i+1 y fin[i] lo notifica ese cliente
+// al terminar su etapa, sin depender de que el proceso salga.
+typedef struct {
+    evento_t inicio[3];
+    evento_t fin[3];
+} sincronizacion_t;
+
+sincronizacion_t *sincronizacion = NULL;
+
+// Política de notificación elegida con -n/--notificacion y --giros.
+enum notificacion modo_notificacion = NOTIFICACION_FUTEX;
+int giros_notificacion = 100;
+
+// Mensajes en vuelo en modo flujo (-p/--pipeline). Con 1 el servidor espera cada
+// resultado antes de enviar el siguiente. Los bytes en vuelo se limitan aparte
+// (ver modo_flujo); el máximo de la ventana sólo acota la memoria del servidor.
+#define VENTANA_MAXIMA 256
+int ventana = 1;
+
+// Lotes en las FIFOs (-b/--lote, --espera-lote): cuántos mensajes se acumulan
+// como máximo antes de escribirlos juntos y cuánto puede esperar el más antiguo.
+#define MAX_LOTES 16
+int lote = 1;
+long espera_lote_us = 200;
+
+// Réplicas de cada etapa en modo flujo (-r/--replicas): el mensaje k lo procesa
+// la réplica k % replicas[etapa], así cada réplica sabe de antemano qué mensajes
+// le tocan y de qué réplica anterior llegan, y el orden se conserva sin reordenar.
+#define NUM_ETAPAS 3
+#define MAX_REPLICAS 8
+#define MAX_CONFIGURACIONES 16
+int replicas[NUM_ETAPAS] = { 1, 1, 1 };
+
+// Hilos del pipeline fusionado (--hilos); 0 significa uno por núcleo.
+int hilos = 1;
+
+// Cómo se verifican los resultados (--verificacion). 'copia' guarda cada mensaje
+// en vuelo (invertido) y lo compara byte a byte; 'crc' guarda sólo el CRC32C del
+// resultado esperado y lee la respuesta por bloques; 'flujo' acumula un único
+// CRC de lo enviado y otro de lo recibido y los compara al final. Con CRC la
+// memoria de verificación no depende del tamaño ni del número de mensajes, pero
+// 'flujo' sólo dice si la corrida entera llegó bien, no qué mensaje falló.
+enum verificacion { VERIFICACION_COPIA, VERIFICACION_CRC, VERIFICACION_FLUJO };
+enum verificacion verificacion = VERIFICACION_COPIA;
+
+const char *nombre_verificacion(enum verificacion v) {
+    switch (v) {
+        case VERIFICACION_CRC:   return "crc";
+        case VERIFICACION_FLUJO: return "flujo";
+        default:                 return "copia";
+    }
+}
+
+// Cómo se crean los procesos de las etapas en modo flujo (--arranque); ver
+// la sección "Arranque de las etapas".
+#define MAX_ARRANQUES 3
+enum arranque { ARRANQUE_FORK, ARRANQUE_SPAWN, ARRANQUE_RESERVA };
+enum arranque arranque = ARRANQUE_FORK;
+
+const char *nombre_arranque(enum arranque a) {
+    switch (a) {
+        case ARRANQUE_SPAWN:   return "spawn";
+        case ARRANQUE_RESERVA: return "reserva";
+        default:               return "fork";
+    }
+}
+
+// Cómo hacen E/S las FIFOs en modo flujo (--es): read/write bloqueantes o
+// io_uring (ver la sección "Motor io_uring").
+enum motor_es { ES_BLOQUEANTE, ES_URING };
+enum motor_es motor_es = ES_BLOQUEANTE;
+
+const char *nombre_motor_es(enum motor_es m) {
+    return m == ES_URING ? "uring" : "bloqueante";
+}
+
+// Cola de admisión del servidor en modo flujo (--cola, --cola-bytes, --sobrecarga):
+// cada mensaje que llega espera ahí a tener crédito para entrar al pipeline (ver
+// modo_flujo). Con la cola llena, 'bloquear' deja de leer la entrada, así quien
+// la produce espera; 'descartar-nuevo' tira el mensaje que llega,
+// 'descartar-viejo' el más antiguo de la cola, y 'rechazar' se lo devuelve a
+// quien lo entregó. Para un archivo de entrada, eso es contarlo y anotarlo en
+// la bitácora.
+#define COLA_MAXIMA (1 << 20)
+enum sobrecarga { SOBRECARGA_BLOQUEAR, SOBRECARGA_DESCARTAR_NUEVO, SOBRECARGA_DESCARTAR_VIEJO, SOBRECARGA_RECHAZAR };
+enum sobrecarga sobrecarga = SOBRECARGA_BLOQUEAR;
+int capacidad_cola = 1;
+size_t bytes_cola = 64 << 20;
+
+const char *nombre_sobrecarga(enum sobrecarga s) {
+    switch (s) {
+        case SOBRECARGA_DESCARTAR_NUEVO: return "descartar-nuevo";
+        case SOBRECARGA_DESCARTAR_VIEJO: return "descartar-viejo";
+        case SOBRECARGA_RECHAZAR:        return "rechazar";
+        default:                         return "bloquear";
+    }
+}
+
+// Llegadas a ritmo fijo (--llegadas R[xB]): ráfagas de B mensajes cada B/R
+// segundos, sin importar si el pipeline da abasto (carga de lazo abierto).
+// Con ritmo 0 la entrada está siempre disponible.
+double ritmo_llegadas = 0.0;
+int rafaga_llegadas = 1;
+
+// Frontal de productores (--escuchar ruta, --conexiones N): en lugar de un
+// archivo, la entrada son las líneas que envían muchos productores por un socket
+// Unix, y cada resultado vuelve por la conexión que lo pidió (ver la sección
+// "Frontal de productores").
+#define CONEXIONES_MAXIMAS (1 << 16)
+const char *ruta_escucha = NULL;
+int capacidad_conexiones = 4096;
+
+// Ubicación de los procesos (--cpus, --prioridad-fifo, --paginas-enormes); ver
+// la sección "Ubicación de los procesos". La ubicación 0 es el servidor y la
+// 1 + e la etapa e (Cliente e + 1) con todas sus réplicas.
+#define NUM_UBICACIONES (1 + NUM_ETAPAS)
+const char *texto_cpus = NULL;          // Como se dio en --cpus, para los reportes y --etapa
+int con_cpus[NUM_UBICACIONES];          // 0: sin conjunto propio
+cpu_set_t cpus_ubicacion[NUM_UBICACIONES];
+int nodo_ubicacion[NUM_UBICACIONES] = { -1, -1, -1, -1 };  // Nodo NUMA preferido para la memoria
+int prioridad_fifo = 0;                 // 0: la política que se heredó
+int paginas_enormes = 0;
+enum paginas { PAGINAS_NORMALES, PAGINAS_THP, PAGINAS_HUGETLB };
+enum paginas paginas_anillos = PAGINAS_NORMALES;    // Lo que se consiguió para la región de anillos
+
+const char *nombre_paginas(enum paginas p) {
+    switch (p) {
+        case PAGINAS_THP:     return "thp";
+        case PAGINAS_HUGETLB: return "hugetlb";
+        default:              return "normales";
+    }
+}
+
+// Formato del reporte de cada corrida en modo flujo (--formato).
+enum formato { FORMATO_TEXTO, FORMATO_CSV, FORMATO_JSON };
+enum formato formato = FORMATO_TEXTO;
+int cabecera_csv_impresa = 0;
+
+// Espera a que 'e' sea notificado al menos una vez desde que valía 'visto'.
+void esperar_notificacion(evento_t *e, uint32_t visto) {
+    while (evento_valor(e) == visto) {
+        evento_esperar(e, visto);
+    }
+}
+
+
+// Función para encriptar una cadena
+void encrypt_string(char *str) {
+    for (int i = 0; str[i] != '\0'; i++) {
+        str[i] += 3; // Suma 3 al valor ASCII
+    }
+}
+
+// Función para desencriptar una cadena
+void decrypt_string(char *str) {
+    for (int i = 0; str[i] != '\0'; i++) {
+        str[i] -= 3; 
+    }
+}
+
+// Función para invertir una cadena
+void reverse_string(char *str) {
+    int length = strlen(str);
+    for (int i = 0; i < length / 2; i++) {
+        char temp = str[i];
+        str[i] = str[length - 1 - i];
+        str[length - 1 - i] = temp;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Bitácora binaria (--bitacora, formato en bitacora.h). Registrar un evento es
+// copiar 32 bytes (más la carga, si se pidió) al anillo del proceso: sin
+// llamadas al sistema ni formateo. Un hilo escritor vacía el anillo cada
+// BITACORA_PERIODO_NS con una sola write. Si el anillo se llena, el registro
+// se descarta y se cuenta; el camino caliente nunca espera al disco. Hay un
+// solo productor por proceso: el hilo principal.
+// ---------------------------------------------------------------------------
+
+#define BITACORA_ANILLO (1 << 20)
+#define BITACORA_PERIODO_NS 1000000
+
+const char *ruta_bitacora = NULL;
+enum nivel_bitacora nivel_bitacora = BITACORA_INFO;   // --nivel-bitacora
+uint32_t carga_bitacora = 0;    // --carga-bitacora: 0 nunca vuelca la carga
+
+const char *nombre_nivel_bitacora(enum nivel_bitacora n) {
+    switch (n) {
+        case BITACORA_ERROR:      return "error";
+        case BITACORA_DEPURACION: return "depuracion";
+        default:                  return "info";
+    }
+}
+
+struct {
+    enum nivel_bitacora nivel;  // BITACORA_NINGUNO mientras no está activa en este proceso
+    pid_t dueno;                // Proceso que la inició (un hijo la hereda inactiva)
+    int fd;
+    uint8_t etapa, replica, replicas;
+    char *datos;
+    _Alignas(LINEA_CACHE) _Atomic uint64_t cabeza;   // Sólo la escribe el productor
+    _Alignas(LINEA_CACHE) _Atomic uint64_t cola;     // Sólo la escribe el hilo escritor
+    _Atomic uint64_t perdidos;
+    _Atomic int terminar;
+    pthread_t escritor;
+} bitacora = { .fd = -1 };
+
+// Crea (o vacía) el archivo y escribe la cabecera; una vez, antes de las etapas.
+void bitacora_crear(void) {
+    int fd = open(ruta_bitacora, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bitacora_cabecera_t cabecera = { BITACORA_MAGIA, BITACORA_VERSION, BITACORA_REGISTRO, reloj_ns() };
+    if (fd == -1 || write(fd, &cabecera, sizeof(cabecera)) != sizeof(cabecera)) {
+        perror(ruta_bitacora);
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+}
+
+void bitacora_copiar(uint64_t posicion, const void *origen, size_t n) {
+    size_t i = posicion & (BITACORA_ANILLO - 1), primero = BITACORA_ANILLO - i < n ? BITACORA_ANILLO - i : n;
+    memcpy(bitacora.datos + i, origen, primero);
+    memcpy(bitacora.datos, (const char *)origen + primero, n - primero);
+}
+
+void bitacora_leer(uint64_t posicion, void *destino, size_t n) {
+    size_t i = posicion & (BITACORA_ANILLO - 1), primero = BITACORA_ANILLO - i < n ? BITACORA_ANILLO - i : n;
+    memcpy(destino, bitacora.datos + i, primero);
+    memcpy((char *)destino + primero, bitacora.datos, n - primero);
+}
+
+// Registros del tramo [cola, cabeza) del anillo que no llegaron enteros al
+// archivo si la escritura sólo alcanzó hasta la posición 'escrito'.
+uint64_t bitacora_sin_escribir(uint64_t cola, uint64_t cabeza, uint64_t escrito) {
+    uint64_t registros = 0;
+    for (uint64_t p = cola; p < cabeza;) {
+        registro_t r;
+        bitacora_leer(p, &r, sizeof(r));
+        p += bitacora_tam_registro(r.carga);
+        if (p > escrito) registros++;
+    }
+    return registros;
+}
+
+void bitacora_registrar(enum nivel_bitacora nivel, enum evento_bitacora evento, uint64_t secuencia,
+                        uint32_t longitud, const void *carga, size_t tam_carga) {
+    if (nivel > bitacora.nivel) return;
+    if (carga == NULL || tam_carga > carga_bitacora) tam_carga = carga == NULL ? 0 : carga_bitacora;
+    uint64_t tam = bitacora_tam_registro(tam_carga);
+    uint64_t cabeza = atomic_load_explicit(&bitacora.cabeza, memory_order_relaxed);
+    if (BITACORA_ANILLO - (cabeza - atomic_load_explicit(&bitacora.cola, memory_order_acquire)) < tam) {
+        atomic_fetch_add_explicit(&bitacora.perdidos, 1, memory_order_relaxed);
+        return;
+    }
+    registro_t r = {
+        .ns = reloj_ns(), .secuencia = secuencia, .pid = (uint32_t)bitacora.dueno, .longitud = longitud,
+        .evento = evento, .carga = (uint16_t)tam_carga, .etapa = bitacora.etapa,
+        .replica = bitacora.replica, .replicas = bitacora.replicas, .nivel = nivel,
+    };
+    bitacora_copiar(cabeza, &r, sizeof(r));
+    if (tam_carga > 0) bitacora_copiar(cabeza + sizeof(r), carga, tam_carga);
+    atomic_store_explicit(&bitacora.cabeza, cabeza + tam, memory_order_release);
+}
+
+// Vuelca lo acumulado en una sola escritura: los descartes como un registro
+// propio y el tramo pendiente del anillo (en dos partes si da la vuelta).
+// Devuelve 1 si escribió todo, 0 si no había nada y -1 si la escritura falló.
+int bitacora_volcar(void) {
+    uint64_t cola = atomic_load_explicit(&bitacora.cola, memory_order_relaxed);
+    uint64_t cabeza = atomic_load_explicit(&bitacora.cabeza, memory_order_acquire);
+    uint64_t perdidos = atomic_exchange_explicit(&bitacora.perdidos, 0, memory_order_relaxed);
+    registro_t aviso = {
+        .ns = reloj_ns(), .pid = (uint32_t)bitacora.dueno, .longitud = (uint32_t)perdidos,
+        .evento = EVENTO_PERDIDOS, .etapa = bitacora.etapa, .replica = bitacora.replica,
+        .replicas = bitacora.replicas, .nivel = BITACORA_ERROR,
+    };
+    struct iovec iov[3];
+    int n = 0;
+    if (perdidos > 0) iov[n++] = (struct iovec){ &aviso, sizeof(aviso) };
+    size_t i = cola & (BITACORA_ANILLO - 1), pendiente = cabeza - cola;
+    size_t primero = BITACORA_ANILLO - i < pendiente ? BITACORA_ANILLO - i : pendiente;
+    if (primero > 0) iov[n++] = (struct iovec){ bitacora.datos + i, primero };
+    if (pendiente > primero) iov[n++] = (struct iovec){ bitacora.datos, pendiente - primero };
+    if (n == 0) return 0;
+    // El archivo es regular y está en O_APPEND: la escritura entra completa y
+    // contigua salvo con el disco lleno o una señal. Lo que falte se reintenta;
+    // si no sale, los registros que no llegaron enteros (y los descartes que
+    // anunciaba el aviso, si tampoco salió) vuelven a contarse como perdidos.
+    size_t tam_aviso = perdidos > 0 ? sizeof(aviso) : 0, total = tam_aviso + pendiente, escrito = 0;
+    for (int k = 0; escrito < total;) {
+        ssize_t r = writev(bitacora.fd, iov + k, n - k);
+        if (r == -1 && errno == EINTR) continue;
+        if (r <= 0) break;
+        escrito += r;
+        for (; k < n && (size_t)r >= iov[k].iov_len; k++) r -= iov[k].iov_len;
+        if (k < n) {
+            iov[k].iov_base = (char *)iov[k].iov_base + r;
+            iov[k].iov_len -= r;
+        }
+    }
+    if (escrito < total) {
+        uint64_t faltan = bitacora_sin_escribir(cola, cabeza, cola + (escrito > tam_aviso ? escrito - tam_aviso : 0));
+        if (escrito < tam_aviso) faltan += perdidos;
+        atomic_fetch_add_explicit(&bitacora.perdidos, faltan, memory_order_relaxed);
+    }
+    atomic_store_explicit(&bitacora.cola, cabeza, memory_order_release);
+    return escrito < total ? -1 : 1;
+}
+
+void *hilo_bitacora(void *arg) {
+    (void)arg;
+    struct timespec periodo = { 0, BITACORA_PERIODO_NS };
+    for (;;) {
+        int terminar = atomic_load_explicit(&bitacora.terminar, memory_order_acquire);
+        // Tras un fallo se espera como si no hubiera nada: el aviso de perdidos
+        // queda pendiente y volver a intentarlo enseguida sólo gira.
+        if (bitacora_volcar() <= 0) {
+            if (terminar) break;
+            nanosleep(&periodo, NULL);
+        }
+    }
+    return NULL;
+}
+
+void bitacora_terminar(void) {
+    if (bitacora.nivel == BITACORA_NINGUNO || bitacora.dueno != getpid()) return;
+    atomic_store_explicit(&bitacora.terminar, 1, memory_order_release);
+    pthread_join(bitacora.escritor, NULL);
+    close(bitacora.fd);
+    free(bitacora.datos);
+    bitacora.nivel = BITACORA_NINGUNO;
+    bitacora.fd = -1;
+    bitacora.datos = NULL;
+}
+
+// Activa la bitácora en este proceso, que se identifica como la réplica 'replica'
+// (de 'replicas') de la etapa 'etapa' (0 es el servidor). Lo que heredó de su
+// padre con fork() se descarta: el hilo escritor no sobrevive al fork. Al salir
+// del proceso, incluso con exit() por un error, se vuelca lo pendiente.
+void bitacora_iniciar(int etapa, int replica, int num_replicas) {
+    static int con_atexit = 0;
+    if (ruta_bitacora == NULL) return;
+    if (bitacora.dueno == getpid()) {
+        bitacora_terminar();
+    } else if (bitacora.nivel != BITACORA_NINGUNO) {
+        close(bitacora.fd);
+        free(bitacora.datos);
+    }
+    bitacora.nivel = BITACORA_NINGUNO;
+    if ((bitacora.fd = open(ruta_bitacora, O_WRONLY | O_APPEND)) == -1 ||
+        (bitacora.datos = malloc(BITACORA_ANILLO)) == NULL) {
+        perror(ruta_bitacora);
+        if (bitacora.fd != -1) close(bitacora.fd);
+        return;
+    }
+    bitacora.dueno = getpid();
+    bitacora.etapa = etapa;
+    bitacora.replica = replica;
+    bitacora.replicas = num_replicas;
+    atomic_store(&bitacora.cabeza, 0);
+    atomic_store(&bitacora.cola, 0);
+    atomic_store(&bitacora.perdidos, 0);
+    atomic_store(&bitacora.terminar, 0);
+    if (pthread_create(&bitacora.escritor, NULL, hilo_bitacora, NULL) != 0) {
+        fprintf(stderr, "%s: no se pudo crear el hilo escritor\n", ruta_bitacora);
+        close(bitacora.fd);
+        free(bitacora.datos);
+        bitacora.fd = -1;
+        bitacora.datos = NULL;
+        return;
+    }
+    bitacora.nivel = nivel_bitacora;
+    // Los hijos heredan el atexit del padre; sólo hace falta registrarlo una vez
+    // por imagen del programa (posix_spawn arranca una nueva).
+    if (!con_atexit) {
+        atexit(bitacora_terminar);
+        con_atexit = 1;
+    }
+    bitacora_registrar(BITACORA_INFO, EVENTO_INICIO, 0, 0, NULL, 0);
+}
+
+// Modo clásico: cada etapa muestra la cadena en cada paso. Con --bitacora el
+// paso queda como registro, con la cadena sólo si --carga-bitacora lo permite.
+void mostrar_cadena(const char *quien, const char *paso, enum evento_bitacora evento, const char *cadena) {
+    if (bitacora.nivel != BITACORA_NINGUNO) {
+        size_t n = strlen(cadena);
+        bitacora_registrar(BITACORA_DEPURACION, evento, 0, n, cadena, n);
+    } else {
+        printf("%s: Cadena %s: '%s'\n", quien, paso, cadena);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Modo flujo: las tres etapas permanecen vivas y procesan un número ilimitado
+// de mensajes sobre los mismos canales abiertos. Cada mensaje viaja como una
+// trama: una cabecera con su longitud seguida de la carga útil, de cualquier
+// tamaño. Las etapas leen la carga por bloques, así encrypt/decrypt transforman
+// y reenvían cada bloque apenas llega, sin esperar el mensaje completo.
+// ---------------------------------------------------------------------------
+
+// Cabecera de cada mensaje en un canal; la siguen 'longitud' bytes de carga.
+typedef struct {
+    uint64_t longitud;
+    uint64_t secuencia;  // Número de mensaje asignado por el servidor
+} cabecera_t;
+
+// Tamaño de los bloques con que una etapa lee y transforma la carga.
+#define BLOQUE_ETAPA (64 * 1024)
+
+// Cota de cordura para la longitud anunciada en una cabecera.
+#define MENSAJE_MAXIMO (1UL << 30)
+
+// Lee exactamente n bytes salvo fin de archivo. Devuelve los bytes leídos o -1.
+ssize_t leer_completo(int fd, void *buf, size_t n) {
+    size_t total = 0;
+    while (total < n) {
+        ssize_t r = read(fd, (char *)buf + total, n - total);
+        if (r == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0) break; // EOF: el escritor cerró la tubería
+        total += r;
+    }
+    return total;
+}
+
+// Escribe exactamente n bytes. Devuelve 0 si tuvo éxito o -1 en caso de error.
+int escribir_completo(int fd, const void *buf, size_t n) {
+    size_t total = 0;
+    while (total < n) {
+        ssize_t w = write(fd, (const char *)buf + total, n - total);
+        if (w == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        total += w;
+    }
+    return 0;
+}
+
+// Como escribir_completo pero con writev: la cabecera y la carga salen en una
+// sola llamada al sistema salvo que la tubería acepte sólo una parte.
+int escribir_vector_completo(int fd, struct iovec *iov, int n) {
+    while (n > 0) {
+        ssize_t w = writev(fd, iov, n);
+        if (w == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (n > 0 && (size_t)w >= iov->iov_len) {
+            w -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *)iov->iov_base + w;
+            iov->iov_len -= w;
+        }
+    }
+    return 0;
+}
+
+double tiempo_actual(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------------------------------------------------------------------------
+// Canales entre etapas. Cada arista del pipeline (message -> encrypt ->
+// reverse -> decrypt -> result) es un flujo de bytes que puede viajar por:
+//   - TRANSPORTE_FIFO: la tubería con nombre de siempre (dos copias en el kernel).
+//   - TRANSPORTE_SHM:  un anillo de bytes en memoria compartida (sin el kernel).
+// TRANSPORTE_FUSIONADO no tiene canales: es la referencia sin IPC (modo_fusionado).
+// ---------------------------------------------------------------------------
+
+enum transporte { TRANSPORTE_FIFO, TRANSPORTE_SHM, TRANSPORTE_FUSIONADO };
+
+// El pipeline tiene cuatro tramos (message, encrypt, decrypt, result). Con
+// réplicas, cada tramo tiene un canal por par (productor, consumidor): todos los
+// canales son de un solo escritor y un solo lector, tanto en FIFO como en SHM.
+#define NUM_TRAMOS 4
+#define MAX_CANALES (2 * MAX_REPLICAS + 2 * MAX_REPLICAS * MAX_REPLICAS)
+#define SHM_ANILLOS "/so_l2_anillos"
+
+// Cada arista en SHM lleva su anillo y dos eventos: 'datos' lo notifica el
+// productor al publicar y 'espacio' el consumidor al consumir bytes.
+typedef struct {
+    anillo_t anillo;
+    evento_t datos;
+    evento_t espacio;
+} arista_t;
+
+// Búfer de lotes de cada extremo FIFO: una read() trae muchos mensajes y los
+// mensajes pequeños se acumulan hasta salir juntos en una write()/writev().
+#define BUFFER_LOTE (64 * 1024)
+
+typedef struct {
+    enum transporte tipo;
+    const char *nombre;         // FIFO asociada (también identifica el canal)
+    int fd;                     // TRANSPORTE_FIFO
+    arista_t *arista;           // TRANSPORTE_SHM
+    // Lotes (sólo TRANSPORTE_FIFO con lote > 1)
+    char *lectura;              // Bytes leídos de la FIFO aún no consumidos
+    size_t lectura_inicio, lectura_fin;
+    char *escritura;            // Mensajes a la espera de salir en una sola llamada
+    size_t escritura_usada;
+    int pendientes;             // Mensajes completos dentro de 'escritura'
+    double primero;             // Cuándo entró el byte pendiente más antiguo
+    // io_uring (sólo con --es uring): el segundo búfer de cada sentido está en vuelo
+    int fijo;                   // Índice del descriptor registrado en el anillo
+    char *adelanto;             // Destino de la lectura adelantada
+    int leyendo, adelanto_listo;
+    ssize_t adelantados;        // Resultado de la lectura adelantada (negativo: -errno)
+    char *enviando;             // Lote que el kernel está escribiendo
+    size_t enviando_tam, enviando_hecho;
+    int escribiendo, enviando_propio, error_escritura;
+} canal_t;
+
+const char *fifos[NUM_TRAMOS] = { FIFO_MESSAGE, FIFO_ENCRYPT, FIFO_DECRYPT, FIFO_RESULT };
+
+// Canales de la configuración de réplicas actual (ver preparar_canales).
+int num_canales = 0;
+int inicio_tramo[NUM_TRAMOS];
+char nombres_canales[MAX_CANALES][32];
+
+// Procesos que escriben en el tramo t (el servidor o las réplicas de la etapa t)
+// y procesos que leen de él (las réplicas de la etapa t + 1 o el servidor).
+int productores_tramo(int t) {
+    return t == 0 ? 1 : replicas[t - 1];
+}
+
+int consumidores_tramo(int t) {
+    return t == NUM_TRAMOS - 1 ? 1 : replicas[t];
+}
+
+int indice_canal(int tramo, int productor, int consumidor) {
+    return inicio_tramo[tramo] + productor * consumidores_tramo(tramo) + consumidor;
+}
+
+// Numera los canales de cada tramo. Un tramo sin réplicas conserva el nombre de
+// siempre; si no, cada FIFO se llama <tramo>_<productor>_<consumidor>.
+void preparar_canales(void) {
+    num_canales = 0;
+    for (int t = 0; t < NUM_TRAMOS; t++) {
+        int productores = productores_tramo(t), consumidores = consumidores_tramo(t);
+        inicio_tramo[t] = num_canales;
+        for (int i = 0; i < productores; i++) {
+            for (int j = 0; j < consumidores; j++) {
+                char *nombre = nombres_canales[num_canales++];
+                if (productores * consumidores == 1) {
+                    snprintf(nombre, sizeof(nombres_canales[0]), "%s", fifos[t]);
+                } else {
+                    snprintf(nombre, sizeof(nombres_canales[0]), "%s_%d_%d", fifos[t], i, j);
+                }
+            }
+        }
+    }
+}
+
+// Región compartida con una arista por canal; se crea antes de los fork().
+arista_t *region_anillos = NULL;
+
+// Contadores de este proceso (llamadas de E/S, tiempos bloqueado, mensajes). En
+// modo flujo apunta a la ranura del proceso dentro del segmento compartido de
+// estadísticas, que el servidor reporta al final y ./estadisticas lee en vivo.
+ranura_t ranura_local;
+ranura_t *ranura = &ranura_local;
+estadisticas_t *estadisticas = NULL;
+
+int canal_abrir(canal_t *c, enum transporte tipo, int indice, int flags) {
+    memset(c, 0, sizeof(*c));
+    c->tipo = tipo;
+    c->nombre = nombres_canales[indice];
+    if (tipo == TRANSPORTE_SHM) {
+        c->arista = &region_anillos[indice];
+        return 0;
+    }
+    // El extremo lector se abre sin bloquear: con réplicas cada proceso abre varias
+    // FIFOs y esperar en cada open() podría formar un ciclo. Vuelve a ser
+    // bloqueante con canal_bloqueante() cuando ya están abiertos los escritores.
+    if ((flags & O_ACCMODE) == O_RDONLY) flags |= O_NONBLOCK;
+    c->fd = open(c->nombre, flags);
+    if (c->fd == -1) return -1;
+    // io_uring siempre pasa por los búferes de lote: es lo que permite leer por
+    // adelantado y dejar escrituras en vuelo.
+    if (lote > 1 || motor_es == ES_URING) {
+        c->lectura = (flags & O_ACCMODE) == O_RDONLY ? malloc(BUFFER_LOTE) : NULL;
+        c->escritura = (flags & O_ACCMODE) == O_WRONLY ? malloc(BUFFER_LOTE) : NULL;
+    }
+    if (motor_es == ES_URING) {
+        c->adelanto = (flags & O_ACCMODE) == O_RDONLY ? malloc(BUFFER_LOTE) : NULL;
+        c->enviando = (flags & O_ACCMODE) == O_WRONLY ? malloc(BUFFER_LOTE) : NULL;
+    }
+    return 0;
+}
+
+int canal_bloqueante(canal_t *c) {
+    if (c->tipo == TRANSPORTE_SHM) return 0;
+    int flags = fcntl(c->fd, F_GETFL);
+    return flags == -1 ? -1 : fcntl(c->fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+// Bytes que el canal retiene sin que nadie lea: el búfer de la tubería o el anillo.
+size_t canal_capacidad(canal_t *c) {
+    if (c->tipo == TRANSPORTE_SHM) return ANILLO_CAPACIDAD;
+    int capacidad = fcntl(c->fd, F_GETPIPE_SZ);
+    return capacidad > 0 ? (size_t)capacidad : 65536;
+}
+
+// Bytes que esperan en el canal de entrada: lo que queda en el lote leído más lo
+// que retiene la tubería (FIONREAD) o el anillo.
+size_t canal_profundidad(canal_t *c) {
+    if (c->tipo == TRANSPORTE_SHM) {
+        anillo_t *a = &c->arista->anillo;
+        return atomic_load_explicit(&a->cabeza, memory_order_acquire) -
+               atomic_load_explicit(&a->cola, memory_order_relaxed);
+    }
+    int en_tuberia = 0;
+    ioctl(c->fd, FIONREAD, &en_tuberia);
+    size_t adelantados = c->adelanto_listo && c->adelantados > 0 ? (size_t)c->adelantados : 0;
+    return c->lectura_fin - c->lectura_inicio + adelantados + (size_t)en_tuberia;
+}
+
+// ---------------------------------------------------------------------------
+// Motor io_uring de las FIFOs (--es uring). Cada proceso crea su anillo con los
+// descriptores de sus canales registrados. Cada entrada mantiene una lectura
+// adelantada en vuelo sobre un segundo búfer y cada salida entrega su lote al
+// kernel sin esperar mientras llena el otro. Lo preparado sale junto en la
+// próxima io_uring_enter(), que es la misma que espera: en régimen, una llamada
+// al sistema por espera en lugar de una read() y una write() por mensaje.
+// Por canal hay a lo sumo una lectura y una escritura en vuelo, porque dos
+// operaciones sobre la misma FIFO podrían completarse en otro orden.
+// ---------------------------------------------------------------------------
+
+uring_t uring = { .fd = -1 };
+int uring_activo = 0;
+
+// Los dos bits bajos del user_data de cada SQE dicen qué operación era; el
+// resto es la dirección del canal_t.
+#define URING_LECTURA     0
+#define URING_ESCRITURA   1
+#define URING_CANCELACION 2
+
+// Siguiente SQE; si la cola de envío está llena, se envía lo preparado sin esperar.
+struct io_uring_sqe *es_sqe(void) {
+    struct io_uring_sqe *sqe;
+    while ((sqe = uring_sqe(&uring)) == NULL) {
+        estadistica_sumar(&ranura->llamadas, 1);
+        if (uring_entrar(&uring, 0, NULL) == -1 && errno != EINTR) return NULL;
+    }
+    return sqe;
+}
+
+int es_leer_adelantado(canal_t *c) {
+    struct io_uring_sqe *sqe = es_sqe();
+    if (sqe == NULL) return -1;
+    uring_preparar(sqe, IORING_OP_READ, c->fijo, c->adelanto, BUFFER_LOTE, (uintptr_t)c | URING_LECTURA);
+    c->leyendo = 1;
+    return 0;
+}
+
+// Escribe c->enviando desde 'desde'. Con 'vector' escribe en cambio el iovec
+// del llamador, que espera la compleción antes de reutilizarlo.
+int es_enviar(canal_t *c, size_t desde, const struct iovec *vector, int num_vector) {
+    struct io_uring_sqe *sqe = es_sqe();
+    if (sqe == NULL) return -1;
+    if (vector != NULL) {
+        uring_preparar(sqe, IORING_OP_WRITEV, c->fijo, vector, num_vector, (uintptr_t)c | URING_ESCRITURA);
+    } else {
+        uring_preparar(sqe, IORING_OP_WRITE, c->fijo, c->enviando + desde, c->enviando_tam - desde,
+                       (uintptr_t)c | URING_ESCRITURA);
+    }
+    c->escribiendo = 1;
+    return 0;
+}
+
+void es_completar(const struct io_uring_cqe *cqe) {
+    canal_t *c = (canal_t *)(uintptr_t)(cqe->user_data & ~(uint64_t)3);
+    switch (cqe->user_data & 3) {
+        case URING_LECTURA:
+            if ((cqe->res == -EINTR || cqe->res == -EAGAIN) && es_leer_adelantado(c) == 0) break;
+            c->adelantados = cqe->res;
+            c->adelanto_listo = 1;
+            c->leyendo = 0;
+            break;
+        case URING_ESCRITURA:
+            if (cqe->res < 0 && cqe->res != -EINTR && cqe->res != -EAGAIN) {
+                c->error_escritura = -cqe->res;
+                c->escribiendo = 0;
+            } else if (cqe->res >= 0) {
+                c->enviando_hecho += cqe->res;
+            }
+            // Una escritura parcial de nuestro lote sigue en otra operación, todavía en orden.
+            if (c->escribiendo && c->error_escritura == 0 && c->enviando_propio &&
+                c->enviando_hecho < c->enviando_tam) {
+                if (es_enviar(c, c->enviando_hecho, NULL, 0) == -1) c->error_escritura = errno;
+                else break;
+            }
+            c->escribiendo = 0;
+            break;
+        default: // URING_CANCELACION: el resultado llega en la CQE de la lectura cancelada
+            break;
+    }
+}
+
+void es_cosechar(void) {
+    struct io_uring_cqe *cqe;
+    while ((cqe = uring_cqe(&uring)) != NULL) {
+        struct io_uring_cqe copia = *cqe;
+        uring_cqe_visto(&uring);
+        es_completar(&copia);
+    }
+}
+
+// Envía lo preparado y, si 'esperar', duerme hasta una compleción o hasta 'plazo'.
+int es_entrar(int esperar, const struct timespec *plazo, _Atomic uint64_t *ns) {
+    estadistica_sumar(&ranura->llamadas, 1);
+    uint64_t t0 = reloj_ns();
+    int r = uring_entrar(&uring, esperar, plazo);
+    estadistica_sumar(ns, reloj_ns() - t0);
+    if (r == -1 && errno != EINTR && errno != ETIME) return -1;
+    es_cosechar();
+    return 0;
+}
+
+// Espera a que termine la operación en vuelo marcada por '*en_vuelo'.
+int es_esperar(const int *en_vuelo, _Atomic uint64_t *ns) {
+    es_cosechar();
+    while (*en_vuelo) {
+        if (es_entrar(1, NULL, ns) == -1) return -1;
+    }
+    return 0;
+}
+
+ssize_t leer_uring(canal_t *c, void *buf, size_t n) {
+    if (c->lectura_inicio == c->lectura_fin) {
+        if (!c->adelanto_listo) {
+            if (!c->leyendo && es_leer_adelantado(c) == -1) return -1;
+            if (es_esperar(&c->leyendo, &ranura->ns_lectura) == -1) return -1;
+        }
+        c->adelanto_listo = 0;
+        ssize_t r = c->adelantados;
+        if (r <= 0) { // Fin de flujo o error: no se adelanta otra lectura
+            if (r < 0) errno = -r;
+            return r < 0 ? -1 : 0;
+        }
+        char *leido = c->adelanto;
+        c->adelanto = c->lectura;
+        c->lectura = leido;
+        c->lectura_inicio = 0;
+        c->lectura_fin = r;
+        if (es_leer_adelantado(c) == -1) return -1;
+    }
+    size_t disponibles = c->lectura_fin - c->lectura_inicio;
+    if (n > disponibles) n = disponibles;
+    memcpy(buf, c->lectura + c->lectura_inicio, n);
+    c->lectura_inicio += n;
+    return n;
+}
+
+// Entrega el lote al kernel y sigue: sólo espera si la escritura anterior del
+// mismo canal todavía no terminó.
+int vaciar_uring(canal_t *c) {
+    if (c->escribiendo && es_esperar(&c->escribiendo, &ranura->ns_escritura) == -1) return -1;
+    if (c->error_escritura) {
+        errno = c->error_escritura;
+        return -1;
+    }
+    char *lleno = c->escritura;
+    c->escritura = c->enviando;
+    c->enviando = lleno;
+    c->enviando_tam = c->escritura_usada;
+    c->enviando_hecho = 0;
+    c->enviando_propio = 1;
+    c->escritura_usada = 0;
+    c->pendientes = 0;
+    return es_enviar(c, 0, NULL, 0);
+}
+
+// Escritura de un iovec del llamador (cargas que no caben en el lote): se espera
+// su compleción. Si el kernel aceptó sólo una parte, el resto sale con writev.
+int escribir_uring(canal_t *c, struct iovec *iov, int n) {
+    if (c->escribiendo && es_esperar(&c->escribiendo, &ranura->ns_escritura) == -1) return -1;
+    size_t total = 0;
+    for (int i = 0; i < n; i++) total += iov[i].iov_len;
+    c->enviando_tam = total;
+    c->enviando_hecho = 0;
+    c->enviando_propio = 0;
+    if (c->error_escritura == 0 && (es_enviar(c, 0, iov, n) == -1 ||
+                                    es_esperar(&c->escribiendo, &ranura->ns_escritura) == -1)) return -1;
+    if (c->error_escritura) {
+        errno = c->error_escritura;
+        return -1;
+    }
+    size_t hecho = c->enviando_hecho;
+    while (n > 0 && hecho >= iov->iov_len) {
+        hecho -= iov->iov_len;
+        iov++;
+        n--;
+    }
+    if (n == 0) return 0;
+    iov->iov_base = (char *)iov->iov_base + hecho;
+    iov->iov_len -= hecho;
+    return escribir_vector_completo(c->fd, iov, n);
+}
+
+// Antes de liberar los búferes no puede quedar nada en vuelo sobre ellos, y el
+// anillo tiene que soltar el archivo para que close() llegue al otro extremo.
+void es_soltar(canal_t *c) {
+    if (c->escribiendo) es_esperar(&c->escribiendo, &ranura->ns_escritura);
+    if (c->leyendo) {
+        struct io_uring_sqe *sqe = es_sqe();
+        if (sqe != NULL) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = (uintptr_t)c | URING_LECTURA;
+            sqe->user_data = (uintptr_t)c | URING_CANCELACION;
+        }
+        es_esperar(&c->leyendo, &ranura->ns_lectura);
+    }
+    uring_soltar_archivo(&uring, c->fijo);
+}
+
+// Crea el anillo del proceso, registra sus FIFOs y deja una lectura en vuelo en
+// cada entrada. Si io_uring no está disponible se sigue con read/write.
+void es_iniciar(enum transporte tipo, canal_t *entradas, int num_entradas, canal_t *salidas, int num_salidas) {
+    if (motor_es != ES_URING || tipo != TRANSPORTE_FIFO) return;
+    int fds[2 * MAX_REPLICAS], n = 0;
+    for (int i = 0; i < num_entradas; i++) {
+        entradas[i].fijo = n;
+        fds[n++] = entradas[i].fd;
+    }
+    for (int i = 0; i < num_salidas; i++) {
+        salidas[i].fijo = n;
+        fds[n++] = salidas[i].fd;
+    }
+    if (uring_iniciar(&uring, 2 * n + 8) == -1 || uring_registrar_archivos(&uring, fds, n) == -1) {
+        fprintf(stderr, "io_uring: %s; se usa read/write\n", strerror(errno));
+        uring_destruir(&uring);
+        return;
+    }
+    uring_activo = 1;
+    for (int i = 0; i < num_entradas; i++) es_leer_adelantado(&entradas[i]);
+}
+
+void es_terminar(void) {
+    if (!uring_activo) return;
+    uring_destruir(&uring);
+    uring_activo = 0;
+}
+
+ssize_t leer_fifo(canal_t *c, void *buf, size_t n) {
+    ssize_t r;
+    uint64_t t0 = reloj_ns();
+    do {
+        estadistica_sumar(&ranura->llamadas, 1);
+    } while ((r = read(c->fd, buf, n)) == -1 && errno == EINTR);
+    estadistica_sumar(&ranura->ns_lectura, reloj_ns() - t0);
+    return r;
+}
+
+// Semántica de read(2): devuelve entre 1 y n bytes, 0 en fin de flujo o -1.
+ssize_t canal_leer(canal_t *c, void *buf, size_t n) {
+    if (c->tipo == TRANSPORTE_FIFO) {
+        if (uring_activo) return leer_uring(c, buf, n);
+        if (c->lectura == NULL) return leer_fifo(c, buf, n);
+        if (c->lectura_inicio == c->lectura_fin) {
+            if (n >= BUFFER_LOTE) return leer_fifo(c, buf, n); // Cargas grandes van directo
+            ssize_t r = leer_fifo(c, c->lectura, BUFFER_LOTE);
+            if (r <= 0) return r;
+            c->lectura_inicio = 0;
+            c->lectura_fin = r;
+        }
+        size_t disponibles = c->lectura_fin - c->lectura_inicio;
+        if (n > disponibles) n = disponibles;
+        memcpy(buf, c->lectura + c->lectura_inicio, n);
+        c->lectura_inicio += n;
+        return n;
+    }
+    arista_t *a = c->arista;
+    size_t leidos;
+    if ((leidos = anillo_leer(&a->anillo, buf, n)) == 0) {
+        // Sólo se mide el tiempo cuando de verdad hay que esperar.
+        uint64_t t0 = reloj_ns();
+        while ((leidos = anillo_leer(&a->anillo, buf, n)) == 0) {
+            uint32_t visto = evento_valor(&a->datos);
+            if ((leidos = anillo_leer(&a->anillo, buf, n)) != 0) break;
+            if (anillo_agotado(&a->anillo)) break;
+            evento_esperar(&a->datos, visto);
+        }
+        estadistica_sumar(&ranura->ns_lectura, reloj_ns() - t0);
+        if (leidos == 0) return 0;
+    }
+    evento_notificar(&a->espacio);
+    return leidos;
+}
+
+// Lee exactamente n bytes salvo fin de flujo. Devuelve los bytes leídos o -1.
+ssize_t canal_leer_completo(canal_t *c, void *buf, size_t n) {
+    size_t total = 0;
+    while (total < n) {
+        ssize_t r = canal_leer(c, (char *)buf + total, n - total);
+        if (r == -1) return -1;
+        if (r == 0) break;
+        total += r;
+    }
+    return total;
+}
+
+int escribir_fifo(canal_t *c, struct iovec *iov, int n) {
+    if (uring_activo) return escribir_uring(c, iov, n);
+    estadistica_sumar(&ranura->llamadas, 1);
+    uint64_t t0 = reloj_ns();
+    int r = escribir_vector_completo(c->fd, iov, n);
+    estadistica_sumar(&ranura->ns_escritura, reloj_ns() - t0);
+    return r;
+}
+
+// Saca de una vez los mensajes acumulados en el lote.
+int canal_vaciar(canal_t *c) {
+    if (c->escritura == NULL || c->escritura_usada == 0) return 0;
+    if (uring_activo) return vaciar_uring(c);
+    struct iovec iov = { c->escritura, c->escritura_usada };
+    c->escritura_usada = 0;
+    c->pendientes = 0;
+    return escribir_fifo(c, &iov, 1);
+}
+
+// Escribe los n bytes completos esperando espacio si hace falta. 0 o -1.
+int canal_escribir(canal_t *c, const void *buf, size_t n) {
+    if (c->tipo == TRANSPORTE_FIFO) {
+        if (c->escritura == NULL) {
+            struct iovec iov = { (void *)buf, n };
+            return escribir_fifo(c, &iov, 1);
+        }
+        if (n > BUFFER_LOTE - c->escritura_usada) {
+            // No cabe en el lote: sale todo junto con writev, sin copiar la carga.
+            struct iovec iov[2] = { { c->escritura, c->escritura_usada }, { (void *)buf, n } };
+            int vacio = c->escritura_usada == 0;
+            c->escritura_usada = 0;
+            c->pendientes = 0;
+            return vacio ? escribir_fifo(c, &iov[1], 1) : escribir_fifo(c, iov, 2);
+        }
+        if (c->escritura_usada == 0) c->primero = tiempo_actual();
+        memcpy(c->escritura + c->escritura_usada, buf, n);
+        c->escritura_usada += n;
+        return 0;
+    }
+    arista_t *a = c->arista;
+    size_t total = 0;
+    while (total < n) {
+        size_t escritos = anillo_escribir(&a->anillo, (const char *)buf + total, n - total);
+        if (escritos == 0) {
+            uint32_t visto = evento_valor(&a->espacio);
+            if ((escritos = anillo_escribir(&a->anillo, (const char *)buf + total, n - total)) == 0) {
+                uint64_t t0 = reloj_ns();
+                evento_esperar(&a->espacio, visto);
+                estadistica_sumar(&ranura->ns_escritura, reloj_ns() - t0);
+                continue;
+            }
+        }
+        total += escritos;
+        evento_notificar(&a->datos);
+    }
+    return 0;
+}
+
+// Marca el fin de un mensaje: el lote sale al llegar a 'lote' mensajes o cuando
+// el más antiguo lleva 'espera_lote_us' esperando.
+int canal_mensaje_completo(canal_t *c) {
+    if (c->escritura == NULL || c->escritura_usada == 0) return 0;
+    if (++c->pendientes >= lote || (tiempo_actual() - c->primero) * 1e6 >= espera_lote_us) {
+        return canal_vaciar(c);
+    }
+    return 0;
+}
+
+// Antes de bloquearse leyendo 'entrada', da a los mensajes pendientes de las
+// 'salidas' lo que le queda de espera_lote_us al más antiguo para completar su
+// lote; si en ese tiempo no llega nada, los envía para no retenerlos mientras
+// el proceso duerme.
+int canal_esperar_entrada(canal_t *entrada, canal_t *salidas, int num_salidas) {
+    double primero = 0.0;
+    int pendientes = 0;
+    for (int i = 0; i < num_salidas; i++) {
+        if (salidas[i].escritura == NULL || salidas[i].escritura_usada == 0) continue;
+        if (!pendientes++ || salidas[i].primero < primero) primero = salidas[i].primero;
+    }
+    if (pendientes == 0) return 0;
+    if (entrada->tipo == TRANSPORTE_FIFO && entrada->lectura_inicio < entrada->lectura_fin) return 0;
+    if (entrada->adelanto_listo) return 0;
+    double restante = espera_lote_us / 1e6 - (tiempo_actual() - primero);
+    if (restante > 0 && uring_activo && entrada->leyendo) {
+        // La lectura adelantada ya está en vuelo: se espera su compleción con plazo.
+        struct timespec plazo = { (time_t)restante, (long)((restante - (time_t)restante) * 1e9) };
+        if (es_entrar(1, &plazo, &ranura->ns_lectura) == -1) return -1;
+        if (entrada->adelanto_listo) return 0;
+    } else if (restante > 0 && entrada->tipo == TRANSPORTE_FIFO) {
+        struct pollfd pfd = { entrada->fd, POLLIN, 0 };
+        struct timespec plazo = { (time_t)restante, (long)((restante - (time_t)restante) * 1e9) };
+        estadistica_sumar(&ranura->llamadas, 1);
+        uint64_t t0 = reloj_ns();
+        int r = ppoll(&pfd, 1, &plazo, NULL);
+        estadistica_sumar(&ranura->ns_lectura, reloj_ns() - t0);
+        if (r > 0) return 0;
+    }
+    for (int i = 0; i < num_salidas; i++) {
+        if (canal_vaciar(&salidas[i]) == -1) return -1;
+    }
+    return 0;
+}
+
+// Envía una trama completa: cabecera y carga en una sola escritura cuando se puede.
+int canal_enviar_trama(canal_t *c, const cabecera_t *cabecera, const void *carga) {
+    if (c->tipo == TRANSPORTE_FIFO && c->escritura == NULL) {
+        struct iovec iov[2] = {
+            { (void *)cabecera, sizeof(cabecera_t) },
+            { (void *)carga, cabecera->longitud },
+        };
+        return escribir_fifo(c, iov, 2);
+    }
+    if (canal_escribir(c, cabecera, sizeof(cabecera_t)) == -1) return -1;
+    if (canal_escribir(c, carga, cabecera->longitud) == -1) return -1;
+    return canal_mensaje_completo(c);
+}
+
+// Devuelve 1 con la cabecera del siguiente mensaje, 0 si el flujo terminó entre
+// mensajes o -1 si hubo un error o una trama truncada o inválida.
+int canal_recibir_cabecera(canal_t *c, cabecera_t *cabecera) {
+    ssize_t r = canal_leer_completo(c, cabecera, sizeof(cabecera_t));
+    if (r == 0) return 0;
+    if (r != sizeof(cabecera_t)) {
+        if (r > 0) errno = EPROTO;
+        return -1;
+    }
+    if (cabecera->longitud > MENSAJE_MAXIMO) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    return 1;
+}
+
+// Cierra el extremo propio; en el extremo escritor avisa el fin de flujo.
+void canal_cerrar(canal_t *c, int escritura) {
+    if (c->tipo == TRANSPORTE_SHM) {
+        if (escritura) {
+            anillo_cerrar(&c->arista->anillo);
+            evento_notificar(&c->arista->datos);
+        }
+        return;
+    }
+    if (escritura) canal_vaciar(c);
+    if (uring_activo) es_soltar(c);
+    free(c->lectura);
+    free(c->escritura);
+    free(c->adelanto);
+    free(c->enviando);
+    close(c->fd);
+}
+
+// Reenvía la carga de un mensaje aplicando 'transformar' bloque a bloque a
+// medida que llega. La cabecera viaja junto con el primer bloque.
+int transformar_en_flujo(canal_t *entrada, canal_t *salida, const cabecera_t *cabecera,
+                         kernel_t transformar, char *bloque) {
+    size_t pendiente = cabecera->longitud;
+    size_t inicio = sizeof(cabecera_t);
+    memcpy(bloque, cabecera, sizeof(cabecera_t));
+    do {
+        size_t pedir = BLOQUE_ETAPA - inicio < pendiente ? BLOQUE_ETAPA - inicio : pendiente;
+        ssize_t n = 0;
+        if (pedir > 0 && (n = canal_leer(entrada, bloque + inicio, pedir)) <= 0) {
+            if (n == 0) errno = EPROTO; // El flujo terminó a mitad de un mensaje
+            return -1;
+        }
+        uint64_t t0 = reloj_ns();
+        transformar(bloque + inicio, n);
+        estadistica_sumar(&ranura->ns_transformacion, reloj_ns() - t0);
+        if (canal_escribir(salida, bloque, inicio + n) == -1) return -1;
+        pendiente -= n;
+        inicio = 0;
+    } while (pendiente > 0);
+    return canal_mensaje_completo(salida);
+}
+
+// Invierte un mensaje a medida que llega: cada bloque se invierte y se copia a
+// su posición espejo, así al recibir el último byte el resultado ya está listo.
+int invertir_en_flujo(canal_t *entrada, canal_t *salida, const cabecera_t *cabecera,
+                      char *bloque, char **mensaje, size_t *capacidad) {
+    size_t longitud = cabecera->longitud;
+    if (longitud > *capacidad) {
+        char *nuevo = realloc(*mensaje, longitud);
+        if (nuevo == NULL) return -1;
+        *mensaje = nuevo;
+        *capacidad = longitud;
+    }
+    size_t recibidos = 0;
+    while (recibidos < longitud) {
+        size_t pedir = longitud - recibidos < BLOQUE_ETAPA ? longitud - recibidos : BLOQUE_ETAPA;
+        ssize_t n = canal_leer(entrada, bloque, pedir);
+        if (n <= 0) {
+            if (n == 0) errno = EPROTO;
+            return -1;
+        }
+        uint64_t t0 = reloj_ns();
+        reverse_buffer(bloque, n);
+        memcpy(*mensaje + longitud - recibidos - n, bloque, n);
+        estadistica_sumar(&ranura->ns_transformacion, reloj_ns() - t0);
+        recibidos += n;
+    }
+    return canal_enviar_trama(salida, cabecera, *mensaje);
+}
+
+// Barrera entre el servidor y todas las réplicas: nadie lee hasta que todos los
+// escritores abrieron sus canales, porque read() sobre una FIFO todavía sin
+// escritor devolvería un falso fin de flujo. Siempre usa futex: FUTEX_WAKE
+// despierta a todos los que esperan, un eventfd sólo a uno.
+evento_t *barrera = NULL;
+uint32_t procesos_flujo = 0;
+
+void barrera_esperar(void) {
+    evento_notificar(barrera);
+    uint32_t visto;
+    while ((visto = evento_valor(barrera)) < procesos_flujo) evento_esperar(barrera, visto);
+}
+
+// Abre las entradas (sin bloquear) y luego las salidas de un proceso del
+// pipeline, espera a los demás y deja las entradas en modo bloqueante.
+int abrir_canales(enum transporte tipo, canal_t *entradas, const int *indices_entrada, int num_entradas,
+                  canal_t *salidas, const int *indices_salida, int num_salidas, const char **fallido) {
+    for (int i = 0; i < num_entradas; i++) {
+        *fallido = nombres_canales[indices_entrada[i]];
+        if (canal_abrir(&entradas[i], tipo, indices_entrada[i], O_RDONLY) == -1) return -1;
+    }
+    for (int i = 0; i < num_salidas; i++) {
+        *fallido = nombres_canales[indices_salida[i]];
+        if (canal_abrir(&salidas[i], tipo, indices_salida[i], O_WRONLY) == -1) return -1;
+    }
+    barrera_esperar();
+    for (int i = 0; i < num_entradas; i++) {
+        *fallido = entradas[i].nombre;
+        if (canal_bloqueante(&entradas[i]) == -1) return -1;
+    }
+    es_iniciar(tipo, entradas, num_entradas, salidas, num_salidas);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Ubicación de los procesos (--cpus, --prioridad-fifo):
+//   --cpus S/C1/C2/C3 da un conjunto de CPUs al servidor y a cada etapa. Cada
+//   uno es una lista como "0-3,8", "nN" (las CPUs del nodo NUMA N, que además
+//   queda como nodo preferido para su memoria) o vacío o '-' (sin fijar: todas
+//   las CPUs, no las del servidor, que se heredan). Si una etapa tiene al menos
+//   tantas CPUs como réplicas, la réplica r usa sólo la r-ésima; si no,
+//   comparten el conjunto. Así cada etapa deja de migrar y los anillos que
+//   comparte con sus vecinas quedan en cachés fijas.
+//   --prioridad-fifo P corre todos bajo SCHED_FIFO con prioridad P. Requiere
+//   CAP_SYS_NICE (o RLIMIT_RTPRIO); si el servidor no puede, se sigue con la
+//   política normal. Con -n giro y menos CPUs que procesos, una etapa que gira
+//   sólo cede la CPU cuando agota sus giros.
+// Se aplica en el servidor al empezar y en cada etapa al entrar a su bucle,
+// sin importar cómo se la lanzó (--arranque).
+// ---------------------------------------------------------------------------
+
+// Lee una lista de CPUs como "0-3,8,10-11". Devuelve -1 si no es válida.
+int leer_lista_cpus(const char *lista, cpu_set_t *cpus) {
+    CPU_ZERO(cpus);
+    const char *p = lista;
+    while (*p != '\0' && *p != '\n') {
+        char *fin;
+        long desde = strtol(p, &fin, 10), hasta = desde;
+        if (fin == p) return -1;
+        if (*fin == '-') {
+            p = fin + 1;
+            hasta = strtol(p, &fin, 10);
+            if (fin == p) return -1;
+        }
+        if (desde < 0 || hasta < desde || hasta >= CPU_SETSIZE) return -1;
+        for (long c = desde; c <= hasta; c++) CPU_SET(c, cpus);
+        p = fin;
+        if (*p == ',') p++;
+        else if (*p != '\0' && *p != '\n') return -1;
+    }
+    return CPU_COUNT(cpus) > 0 ? 0 : -1;
+}
+
+// Interpreta --cpus. Devuelve -1 (con el mensaje ya impreso) si no es válido.
+int leer_ubicaciones(const char *texto) {
+    char copia[256];
+    snprintf(copia, sizeof(copia), "%s", texto);
+    char *resto = copia;
+    for (int u = 0; u < NUM_UBICACIONES; u++) {
+        char *campo = resto != NULL ? strsep(&resto, "/") : NULL;
+        con_cpus[u] = 0;
+        nodo_ubicacion[u] = -1;
+        if (campo == NULL || *campo == '\0' || strcmp(campo, "-") == 0) continue;
+        if (campo[0] == 'n') {
+            char ruta[64], lista[1024];
+            int nodo = atoi(campo + 1);
+            if (nodo < 0 || nodo >= (int)(8 * sizeof(unsigned long))) nodo = -1;
+            snprintf(ruta, sizeof(ruta), "/sys/devices/system/node/node%d/cpulist", nodo);
+            FILE *f = fopen(ruta, "r");
+            int leida = nodo >= 0 && f != NULL && fgets(lista, sizeof(lista), f) != NULL;
+            if (f != NULL) fclose(f);
+            if (!leida || leer_lista_cpus(lista, &cpus_ubicacion[u]) == -1) {
+                fprintf(stderr, "Nodo NUMA inválido o sin CPUs: '%s'\n", campo);
+                return -1;
+            }
+            nodo_ubicacion[u] = nodo;
+        } else if (leer_lista_cpus(campo, &cpus_ubicacion[u]) == -1) {
+            fprintf(stderr, "Lista de CPUs inválida: '%s'\n", campo);
+            return -1;
+        }
+        con_cpus[u] = 1;
+    }
+    if (resto != NULL) {
+        fprintf(stderr, "--cpus admite hasta %d conjuntos: servidor/cliente1/cliente2/cliente3\n", NUM_UBICACIONES);
+        return -1;
+    }
+    texto_cpus = texto;
+    return 0;
+}
+
+// Fija CPUs, nodo de memoria y política del proceso actual: la ubicación 'u'
+// (0 el servidor, 1 + e la etapa e) y su réplica 'replica'.
+void ubicar_proceso(const char *nombre, int u, int replica) {
+    if (texto_cpus != NULL) {
+        cpu_set_t cpus;
+        if (!con_cpus[u]) {
+            // Sin conjunto propio: todas las CPUs (el kernel lo recorta al cpuset).
+            memset(&cpus, 0xff, sizeof(cpus));
+        } else {
+            cpus = cpus_ubicacion[u];
+            int total = CPU_COUNT(&cpus);
+            if (u > 0 && total >= replicas[u - 1]) {
+                int elegida = -1;
+                for (int c = 0, k = 0; c < CPU_SETSIZE && elegida == -1; c++) {
+                    if (CPU_ISSET(c, &cpus) && k++ == replica) elegida = c;
+                }
+                CPU_ZERO(&cpus);
+                CPU_SET(elegida, &cpus);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) == -1) {
+            fprintf(stderr, "%s: sched_setaffinity: %s\n", nombre, strerror(errno));
+        }
+        if (nodo_ubicacion[u] >= 0) {
+            unsigned long nodos = 1UL << nodo_ubicacion[u];
+            if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodos, 8 * sizeof(nodos) + 1) == -1) {
+                fprintf(stderr, "%s: set_mempolicy: %s\n", nombre, strerror(errno));
+            }
+        }
+    }
+    if (prioridad_fifo > 0) {
+        struct sched_param parametro = { .sched_priority = prioridad_fifo };
+        if (sched_setscheduler(0, SCHED_FIFO, &parametro) == -1) {
+            fprintf(stderr, "%s: SCHED_FIFO %d: %s%s\n", nombre, prioridad_fifo, strerror(errno),
+                    u == 0 ? "; se sigue con la política normal" : "");
+            // Las etapas lanzadas después ni lo intentan.
+            if (u == 0) prioridad_fifo = 0;
+        }
+    }
+}
+
+// Bucle de una réplica de etapa en modo flujo: abre sus canales una sola vez y
+// procesa los mensajes replica, replica + N, replica + 2N... (N = réplicas de
+// la etapa). El mensaje k llega por el canal de la réplica k % N' de la etapa
+// anterior y sale hacia la réplica k % N'' de la siguiente, así que leer y
+// escribir en ese orden conserva el orden global sin búferes de reordenamiento.
+// Vuelve al terminar el flujo (el trabajador de la reserva espera otra corrida);
+// ante un error sale del proceso.
+void etapa_flujo(const char *nombre, enum transporte tipo, int etapa, int replica, kernel_t transformar) {
+    canal_t entradas[MAX_REPLICAS], salidas[MAX_REPLICAS];
+    int indices_entrada[MAX_REPLICAS], indices_salida[MAX_REPLICAS];
+    int num_entradas = productores_tramo(etapa), num_salidas = consumidores_tramo(etapa + 1);
+    cabecera_t cabecera;
+    char *bloque = malloc(BLOQUE_ETAPA);
+    char *mensaje = NULL;   // Sólo la etapa que invierte guarda el mensaje completo
+    size_t capacidad = 0;
+    const char *fallido;
+    int r = -1;
+
+    ubicar_proceso(nombre, 1 + etapa, replica);
+    if (bloque == NULL) {
+        fprintf(stderr, "%s: malloc: %s\n", nombre, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num_entradas; i++) indices_entrada[i] = indice_canal(etapa, i, replica);
+    for (int i = 0; i < num_salidas; i++) indices_salida[i] = indice_canal(etapa + 1, replica, i);
+    if (abrir_canales(tipo, entradas, indices_entrada, num_entradas,
+                      salidas, indices_salida, num_salidas, &fallido) == -1) {
+        fprintf(stderr, "%s: open %s: %s\n", nombre, fallido, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    bitacora_iniciar(etapa + 1, replica, replicas[etapa]);
+
+    uint64_t secuencia = replica;
+    for (;;) {
+        canal_t *entrada = &entradas[secuencia % num_entradas];
+        canal_t *salida = &salidas[secuencia % num_salidas];
+        if (canal_esperar_entrada(entrada, salidas, num_salidas) == -1) {
+            bitacora_registrar(BITACORA_ERROR, EVENTO_FALLO, secuencia, errno, NULL, 0);
+            fprintf(stderr, "%s: write: %s\n", nombre, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        if ((r = canal_recibir_cabecera(entrada, &cabecera)) != 1) break;
+        if (cabecera.secuencia != secuencia) {
+            fprintf(stderr, "%s: se esperaba el mensaje %llu y llegó el %llu por %s\n", nombre,
+                    (unsigned long long)secuencia, (unsigned long long)cabecera.secuencia, entrada->nombre);
+            exit(EXIT_FAILURE);
+        }
+        uint64_t n = estadistica_leer(&ranura->mensajes);
+        if (n % PERIODO_PROFUNDIDAD == 0) estadistica_profundidad(ranura, canal_profundidad(entrada));
+        int ok = transformar == reverse_buffer
+                     ? invertir_en_flujo(entrada, salida, &cabecera, bloque, &mensaje, &capacidad)
+                     : transformar_en_flujo(entrada, salida, &cabecera, transformar, bloque);
+        if (ok == -1) {
+            bitacora_registrar(BITACORA_ERROR, EVENTO_FALLO, cabecera.secuencia, errno, NULL, 0);
+            fprintf(stderr, "%s: mensaje %llu entre %s y %s: %s\n", nombre,
+                    (unsigned long long)cabecera.secuencia, entrada->nombre, salida->nombre,
+                    strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        estadistica_fijar(&ranura->mensajes, n + 1);
+        estadistica_sumar(&ranura->bytes, cabecera.longitud);
+        bitacora_registrar(BITACORA_DEPURACION, EVENTO_PROCESADO, cabecera.secuencia, cabecera.longitud, NULL, 0);
+        secuencia += replicas[etapa];
+    }
+    if (r == -1) {
+        bitacora_registrar(BITACORA_ERROR, EVENTO_FALLO, secuencia, errno, NULL, 0);
+        fprintf(stderr, "%s: read %s: %s\n", nombre, entradas[secuencia % num_entradas].nombre,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    free(bloque);
+    free(mensaje);
+    for (int i = 0; i < num_entradas; i++) canal_cerrar(&entradas[i], 0);
+    for (int i = 0; i < num_salidas; i++) canal_cerrar(&salidas[i], 1); // Propaga el fin de flujo
+    es_terminar();
+    bitacora_registrar(BITACORA_INFO, EVENTO_FIN, estadistica_leer(&ranura->mensajes), 0, NULL, 0);
+    bitacora_terminar();
+}
+
+// Con --paginas-enormes la región de anillos (varios MB que todos los procesos
+// recorren) va en páginas de 2 MB para ahorrar fallos de TLB. Primero se
+// intenta un archivo en hugetlbfs, que necesita páginas reservadas
+// (vm.nr_hugepages); si no hay, la región de siempre en /dev/shm con
+// MADV_HUGEPAGE, que el THP de shmem respeta si shmem_enabled lo permite.
+char ruta_anillos_enormes[512];
+size_t tam_region_anillos = 0;
+
+// Arma ruta_anillos_enormes en el primer hugetlbfs montado; 0 si no hay ninguno.
+int ruta_hugetlbfs(size_t *tam_pagina) {
+    FILE *montajes = setmntent("/proc/mounts", "r");
+    struct mntent *m;
+    int encontrado = 0;
+    while (!encontrado && montajes != NULL && (m = getmntent(montajes)) != NULL) {
+        struct statfs fs;
+        if (strcmp(m->mnt_type, "hugetlbfs") != 0 || statfs(m->mnt_dir, &fs) == -1) continue;
+        snprintf(ruta_anillos_enormes, sizeof(ruta_anillos_enormes), "%s%s", m->mnt_dir, SHM_ANILLOS);
+        *tam_pagina = fs.f_bsize;
+        encontrado = 1;
+    }
+    if (montajes != NULL) endmntent(montajes);
+    return encontrado;
+}
+
+// Mapea la región de anillos en region_anillos; con 'crear' la crea (y la de
+// una corrida anterior se descarta). Los procesos que no la heredan la buscan
+// donde la haya dejado el servidor: en hugetlbfs si el archivo existe.
+int mapear_anillos(int crear) {
+    size_t tam = num_canales * sizeof(arista_t), tam_pagina;
+    paginas_anillos = PAGINAS_NORMALES;
+    if (paginas_enormes && ruta_hugetlbfs(&tam_pagina)) {
+        if (crear) unlink(ruta_anillos_enormes);
+        int fd = open(ruta_anillos_enormes, crear ? O_CREAT | O_EXCL | O_RDWR : O_RDWR, 0600);
+        struct stat st;
+        if (fd != -1 && !crear && fstat(fd, &st) == 0) tam = st.st_size; // Ya redondeado por el servidor
+        size_t redondeado = (tam + tam_pagina - 1) / tam_pagina * tam_pagina;
+        // Sin páginas reservadas, mmap falla con ENOMEM y se sigue sin hugetlbfs.
+        void *region = fd == -1 ? MAP_FAILED
+                                : mmap(NULL, redondeado, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (fd != -1) close(fd);
+        if (region != MAP_FAILED) {
+            region_anillos = region;
+            tam_region_anillos = redondeado;
+            paginas_anillos = PAGINAS_HUGETLB;
+            return 0;
+        }
+        if (crear) unlink(ruta_anillos_enormes);
+        tam = num_canales * sizeof(arista_t);
+    }
+    int fd = shm_open(SHM_ANILLOS, crear ? O_CREAT | O_RDWR : O_RDWR, 0600);
+    if (fd == -1) {
+        perror("shm_open " SHM_ANILLOS);
+        return -1;
+    }
+    if (crear && ftruncate(fd, tam) == -1) {
+        perror("ftruncate " SHM_ANILLOS);
+        close(fd);
+        return -1;
+    }
+    region_anillos = mmap(NULL, tam, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region_anillos == MAP_FAILED) {
+        perror("mmap " SHM_ANILLOS);
+        return -1;
+    }
+    tam_region_anillos = tam;
+    if (paginas_enormes && madvise(region_anillos, tam, MADV_HUGEPAGE) == 0) paginas_anillos = PAGINAS_THP;
+    return 0;
+}
+
+// Crea los recursos del transporte elegido: las FIFOs o la región de anillos.
+void crear_transporte(enum transporte tipo) {
+    if (tipo == TRANSPORTE_FIFO) {
+        for (int i = 0; i < num_canales; i++) {
+            if (mkfifo(nombres_canales[i], 0666) == -1 && errno != EEXIST) {
+                fprintf(stderr, "mkfifo %s: %s\n", nombres_canales[i], strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+        }
+        return;
+    }
+    if (mapear_anillos(1) == -1) exit(EXIT_FAILURE);
+    for (int i = 0; i < num_canales; i++) {
+        anillo_iniciar(&region_anillos[i].anillo);
+        if (evento_iniciar(&region_anillos[i].datos, modo_notificacion, giros_notificacion) == -1 ||
+            evento_iniciar(&region_anillos[i].espacio, modo_notificacion, giros_notificacion) == -1) {
+            perror("eventfd");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void destruir_transporte(enum transporte tipo) {
+    if (tipo == TRANSPORTE_FIFO) {
+        for (int i = 0; i < num_canales; i++) {
+            if (unlink(nombres_canales[i]) == -1) {
+                fprintf(stderr, "unlink %s: %s\n", nombres_canales[i], strerror(errno));
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < num_canales; i++) {
+        evento_destruir(&region_anillos[i].datos);
+        evento_destruir(&region_anillos[i].espacio);
+    }
+    munmap(region_anillos, tam_region_anillos);
+    region_anillos = NULL;
+    if (paginas_anillos == PAGINAS_HUGETLB) {
+        if (unlink(ruta_anillos_enormes) == -1) perror(ruta_anillos_enormes);
+    } else if (shm_unlink(SHM_ANILLOS) == -1) {
+        perror("shm_unlink " SHM_ANILLOS);
+    }
+}
+
+const char *nombre_transporte(enum transporte tipo) {
+    switch (tipo) {
+        case TRANSPORTE_SHM:       return "shm";
+        case TRANSPORTE_FUSIONADO: return "fusionado";
+        default:                   return "fifo";
+    }
+}
+
+const char *nombre_notificacion(enum notificacion modo) {
+    switch (modo) {
+        case NOTIFICACION_EVENTFD: return "eventfd";
+        case NOTIFICACION_GIRO:    return "giro";
+        default:                   return "futex";
+    }
+}
+
+// Crea el segmento de estadísticas con una ranura por proceso (la 0 es el
+// servidor). Si quedó uno de una corrida anterior se reutiliza desde cero.
+void crear_estadisticas(enum transporte tipo, const char *nombres[], int num_ranuras) {
+    int fd = shm_open(SHM_ESTADISTICAS, O_CREAT | O_RDWR, 0600);
+    if (fd == -1) {
+        perror("shm_open " SHM_ESTADISTICAS);
+        exit(EXIT_FAILURE);
+    }
+    if (ftruncate(fd, sizeof(estadisticas_t)) == -1) {
+        perror("ftruncate " SHM_ESTADISTICAS);
+        exit(EXIT_FAILURE);
+    }
+    estadisticas = mmap(NULL, sizeof(estadisticas_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (estadisticas == MAP_FAILED) {
+        perror("mmap " SHM_ESTADISTICAS);
+        exit(EXIT_FAILURE);
+    }
+    memset(estadisticas, 0, sizeof(estadisticas_t));
+    estadisticas->num_ranuras = num_ranuras;
+    estadisticas->inicio_ns = reloj_ns();
+    snprintf(estadisticas->transporte, sizeof(estadisticas->transporte), "%s", nombre_transporte(tipo));
+    for (int i = 0; i < num_ranuras; i++) {
+        snprintf(estadisticas->ranuras[i].nombre, sizeof(estadisticas->ranuras[i].nombre), "%s", nombres[i]);
+    }
+    atomic_store_explicit(&estadisticas->ranuras[0].pid, getpid(), memory_order_relaxed);
+    atomic_store_explicit(&estadisticas->activo, 1, memory_order_release);
+    ranura = &estadisticas->ranuras[0];
+}
+
+// Marca la corrida como terminada (los lectores se desconectan) y borra el segmento.
+void destruir_estadisticas(void) {
+    atomic_store_explicit(&estadisticas->activo, 0, memory_order_release);
+    munmap(estadisticas, sizeof(estadisticas_t));
+    estadisticas = NULL;
+    ranura = &ranura_local;
+    if (shm_unlink(SHM_ESTADISTICAS) == -1) {
+        perror("shm_unlink " SHM_ESTADISTICAS);
+    }
+}
+
+double segundos_cpu(const struct rusage *uso) {
+    return uso->ru_utime.tv_sec + uso->ru_utime.tv_usec / 1e6 +
+           uso->ru_stime.tv_sec + uso->ru_stime.tv_usec / 1e6;
+}
+
+// Resultado de una corrida en modo flujo, tal como se reporta con --formato.
+typedef struct {
+    enum transporte transporte;
+    unsigned long mensajes;
+    unsigned long errores;
+    size_t bytes;
+    double segundos;
+    double duracion;             // Toda la corrida, si difiere de 'segundos' (con el frontal)
+    int hilos;                   // Sólo el pipeline fusionado usa más de uno
+    double arranque;             // Desde lanzar las etapas hasta que todas abrieron sus canales
+    double primer_resultado;     // Desde lanzar las etapas hasta recibir el primer resultado
+    uint64_t llamadas;           // Llamadas de E/S de todos los procesos
+    double cpu[4];               // Segundos de CPU: servidor y clientes 1 a 3 (todas sus réplicas)
+    const histograma_t *latencias;
+    const ranura_t *etapas;      // Copia final de las ranuras de estadísticas
+    int num_etapas;
+    // Admisión y créditos (ver modo_flujo); en cero en el pipeline fusionado
+    unsigned long llegados, descartados, rechazados;
+    int cola_maxima;
+    double cola_media;
+    unsigned long en_vuelo_maximo;
+    size_t bytes_en_vuelo_maximo;
+    // Frontal de productores (--escuchar); en cero si la entrada es un archivo
+    unsigned long conexiones, huerfanos;
+    int conexiones_maximas;
+} resultado_t;
+
+// Porcentaje del tiempo de la corrida que representan 'ns' nanosegundos.
+double porcentaje_corrida(const resultado_t *r, const _Atomic uint64_t *ns) {
+    double segundos = r->duracion > 0 ? r->duracion : r->segundos;
+    return segundos > 0 ? estadistica_leer(ns) / 1e7 / segundos : 0.0;
+}
+
+// Réplicas por etapa como "N1xN2xN3".
+const char *texto_replicas(void) {
+    static char texto[16];
+    snprintf(texto, sizeof(texto), "%dx%dx%d", replicas[0], replicas[1], replicas[2]);
+    return texto;
+}
+
+// Columnas de --formato csv; reportar_resultado las emite en este orden.
+#define COLUMNAS_CSV "transporte,notificacion,giros,ventana,lote,replicas,hilos,verificacion,arranque,es," \
+                     "cpus,fifo,paginas," \
+                     "cola,sobrecarga,mensajes,errores,descartados,rechazados," \
+                     "bytes,segundos,mensajes_s,mb_s,arranque_ms,primer_resultado_ms," \
+                     "latencia_media_us,p50_us,p99_us,p999_us,max_us,cola_max,cola_media,en_vuelo_max," \
+                     "conexiones,conexiones_max," \
+                     "llamadas_por_mensaje,cpu_servidor_s,cpu_cliente1_s,cpu_cliente2_s,cpu_cliente3_s"
+
+void reportar_resultado(const resultado_t *r) {
+    const char *t = nombre_transporte(r->transporte);
+    const char *n = nombre_notificacion(modo_notificacion);
+    double mps = r->segundos > 0 ? r->mensajes / r->segundos : 0.0;
+    double mbs = r->segundos > 0 ? r->bytes / r->segundos / 1e6 : 0.0;
+    double media = histograma_media(r->latencias) / 1e3;
+    double p50 = histograma_percentil(r->latencias, 0.50) / 1e3;
+    double p99 = histograma_percentil(r->latencias, 0.99) / 1e3;
+    double p999 = histograma_percentil(r->latencias, 0.999) / 1e3;
+    double maximo = r->latencias->maximo / 1e3;
+    double lpm = r->mensajes ? (double)r->llamadas / r->mensajes : 0.0;
+    // El pipeline fusionado no lanza procesos.
+    const char *a = r->transporte == TRANSPORTE_FUSIONADO ? "ninguno" : nombre_arranque(arranque);
+    // io_uring sólo se usa sobre las FIFOs.
+    const char *es = r->transporte == TRANSPORTE_FIFO ? nombre_motor_es(motor_es) : "ninguno";
+    int cola = r->transporte == TRANSPORTE_FUSIONADO ? 0 : capacidad_cola;
+    const char *s = r->transporte == TRANSPORTE_FUSIONADO ? "ninguna" : nombre_sobrecarga(sobrecarga);
+    // En CSV las comas de una lista de CPUs (0-3,8) se escriben como ';' para
+    // no correr las columnas; JSON la conserva tal cual.
+    const char *cpus = texto_cpus != NULL ? texto_cpus : "ninguna";
+    char cpus_csv[256];
+    snprintf(cpus_csv, sizeof(cpus_csv), "%s", cpus);
+    for (char *c = cpus_csv; (c = strchr(c, ',')) != NULL; c++) *c = ';';
+    // Sólo la región de anillos de shm puede ir en páginas enormes.
+    const char *paginas = r->transporte == TRANSPORTE_SHM ? nombre_paginas(paginas_anillos) : "normales";
+
+    switch (formato) {
+        case FORMATO_CSV:
+            if (!cabecera_csv_impresa) {
+                printf("%s\n", COLUMNAS_CSV);
+                cabecera_csv_impresa = 1;
+            }
+            printf("%s,%s,%d,%d,%d,%s,%d,%s,%s,%s,%s,%d,%s,%d,%s,%lu,%lu,%lu,%lu,%zu,%.6f,%.1f,%.3f,%.3f,%.3f,"
+                   "%.2f,%.2f,%.2f,%.2f,%.2f,%d,%.2f,%lu,%lu,%d,%.3f,%.4f,%.4f,%.4f,%.4f\n",
+                   t, n, giros_notificacion, ventana, lote, texto_replicas(), r->hilos,
+                   nombre_verificacion(verificacion), a, es, cpus_csv, prioridad_fifo, paginas, cola, s,
+                   r->mensajes, r->errores, r->descartados, r->rechazados, r->bytes, r->segundos, mps, mbs, r->arranque * 1e3, r->primer_resultado * 1e3,
+                   media, p50, p99, p999, maximo, r->cola_maxima, r->cola_media, r->en_vuelo_maximo,
+                   r->conexiones, r->conexiones_maximas, lpm,
+                   r->cpu[0], r->cpu[1], r->cpu[2], r->cpu[3]);
+            break;
+        case FORMATO_JSON:
+            printf("{\"transporte\":\"%s\",\"notificacion\":\"%s\",\"giros\":%d,\"ventana\":%d,\"lote\":%d,"
+                   "\"replicas\":\"%s\",\"hilos\":%d,\"verificacion\":\"%s\",\"es\":\"%s\","
+                   "\"ubicacion\":{\"cpus\":\"%s\",\"fifo\":%d,\"paginas\":\"%s\"},\"mensajes\":%lu,\"errores\":%lu,"
+                   "\"cola\":{\"capacidad\":%d,\"sobrecarga\":\"%s\",\"llegadas\":%lu,\"descartados\":%lu,"
+                   "\"rechazados\":%lu,\"maxima\":%d,\"media\":%.2f},\"en_vuelo_max\":%lu,\"bytes_en_vuelo_max\":%zu,"
+                   "\"frontal\":{\"conexiones\":%lu,\"maximo\":%d,\"sin_destinatario\":%lu},"
+                   "\"bytes\":%zu,\"segundos\":%.6f,\"mensajes_s\":%.1f,\"mb_s\":%.3f,"
+                   "\"arranque\":{\"modo\":\"%s\",\"listo_ms\":%.3f,\"primer_resultado_ms\":%.3f},\"latencia_us\":{\"media\":%.2f,\"p50\":%.2f,"
+                   "\"p99\":%.2f,\"p999\":%.2f,\"max\":%.2f},\"llamadas_por_mensaje\":%.3f,"
+                   "\"cpu_s\":{\"servidor\":%.4f,\"cliente1\":%.4f,\"cliente2\":%.4f,\"cliente3\":%.4f},"
+                   "\"etapas\":[",
+                   t, n, giros_notificacion, ventana, lote, texto_replicas(), r->hilos,
+                   nombre_verificacion(verificacion), es, cpus, prioridad_fifo, paginas, r->mensajes, r->errores,
+                   cola, s, r->llegados,
+                   r->descartados, r->rechazados, r->cola_maxima, r->cola_media, r->en_vuelo_maximo,
+                   r->bytes_en_vuelo_maximo, r->conexiones, r->conexiones_maximas, r->huerfanos, r->bytes,
+                   r->segundos, mps, mbs, a, r->arranque * 1e3, r->primer_resultado * 1e3, media, p50, p99, p999,
+                   maximo, lpm,
+                   r->cpu[0], r->cpu[1], r->cpu[2], r->cpu[3]);
+            for (int i = 0; i < r->num_etapas; i++) {
+                const ranura_t *e = &r->etapas[i];
+                printf("%s{\"nombre\":\"%s\",\"mensajes\":%llu,\"lectura_pct\":%.2f,"
+                       "\"transformacion_pct\":%.2f,\"escritura_pct\":%.2f,\"profundidad_max\":%llu}",
+                       i ? "," : "", e->nombre, (unsigned long long)estadistica_leer(&e->mensajes),
+                       porcentaje_corrida(r, &e->ns_lectura), porcentaje_corrida(r, &e->ns_transformacion),
+                       porcentaje_corrida(r, &e->ns_escritura),
+                       (unsigned long long)estadistica_leer(&e->profundidad_maxima));
+            }
+            printf("]}\n");
+            break;
+        default: {
+            // Las réplicas sólo se nombran si hay más de una en alguna etapa.
+            char etiqueta[64];
+            int con_replicas = replicas[0] * replicas[1] * replicas[2] > 1;
+            if (r->transporte == TRANSPORTE_FUSIONADO) {
+                snprintf(etiqueta, sizeof(etiqueta), "%s, %d hilos", t, r->hilos);
+            } else {
+                int con_uring = r->transporte == TRANSPORTE_FIFO && motor_es == ES_URING;
+                snprintf(etiqueta, sizeof(etiqueta), "%s, lote %d%s%s%s%s%s", t, lote,
+                         con_replicas ? ", réplicas " : "", con_replicas ? texto_replicas() : "",
+                         arranque != ARRANQUE_FORK ? ", " : "", arranque != ARRANQUE_FORK ? a : "",
+                         con_uring ? ", uring" : "");
+            }
+            printf("Servidor [%s]: %lu mensajes procesados, %lu no coinciden%s%s%s.\n",
+                   etiqueta, r->mensajes, r->errores, verificacion == VERIFICACION_COPIA ? "" : " (verificación ",
+                   verificacion == VERIFICACION_COPIA ? "" : nombre_verificacion(verificacion),
+                   verificacion == VERIFICACION_COPIA ? "" : " con CRC32C)");
+            printf("Servidor [%s]: %.3f s, %.0f mensajes/s, %.1f MB/s\n", etiqueta,
+                   r->segundos, mps, mbs);
+            printf("Servidor [%s]: latencia us media %.1f, p50 %.1f, p99 %.1f, p99.9 %.1f, máx. %.1f\n",
+                   etiqueta, media, p50, p99, p999, maximo);
+            if (texto_cpus != NULL || prioridad_fifo > 0 || paginas_enormes) {
+                printf("Servidor [%s]: ubicación: CPUs %s, %s%.0d, páginas %s\n", etiqueta, cpus,
+                       prioridad_fifo > 0 ? "SCHED_FIFO " : "política heredada", prioridad_fifo, paginas);
+            }
+            if (r->transporte == TRANSPORTE_FUSIONADO) {
+                printf("Servidor [%s]: CPU s %.3f entre todos los hilos\n", etiqueta, r->cpu[0]);
+            } else {
+                printf("Servidor [%s]: %.2f llamadas de E/S por mensaje; CPU s servidor %.3f, "
+                       "clientes %.3f %.3f %.3f\n", etiqueta, lpm, r->cpu[0], r->cpu[1], r->cpu[2], r->cpu[3]);
+                printf("Servidor [%s]: arranque con %s: etapas listas en %.3f ms, primer resultado a los %.3f ms\n",
+                       etiqueta, a, r->arranque * 1e3, r->primer_resultado * 1e3);
+                if (capacidad_cola > 1 || ritmo_llegadas > 0 || r->descartados + r->rechazados > 0) {
+                    printf("Servidor [%s]: cola de %d (%s): %lu llegadas, %lu descartadas, %lu rechazadas; "
+                           "ocupación máx. %d, media %.1f; en vuelo máx. %lu mensajes, %zu B\n", etiqueta,
+                           capacidad_cola, s, r->llegados, r->descartados, r->rechazados, r->cola_maxima,
+                           r->cola_media, r->en_vuelo_maximo, r->bytes_en_vuelo_maximo);
+                }
+                if (r->conexiones > 0) {
+                    printf("Servidor [%s]: frontal: %lu conexiones, máx. %d simultáneas, %lu resultados sin "
+                           "destinatario\n", etiqueta, r->conexiones, r->conexiones_maximas, r->huerfanos);
+                }
+            }
+            for (int i = 0; i < r->num_etapas; i++) {
+                const ranura_t *e = &r->etapas[i];
+                printf("Servidor [%s]: %-11s bloqueado leyendo %5.1f%%, transformando %5.1f%%, "
+                       "bloqueado escribiendo %5.1f%%, cola máx. %llu B\n", etiqueta, e->nombre,
+                       porcentaje_corrida(r, &e->ns_lectura), porcentaje_corrida(r, &e->ns_transformacion),
+                       porcentaje_corrida(r, &e->ns_escritura),
+                       (unsigned long long)estadistica_leer(&e->profundidad_maxima));
+            }
+            break;
+        }
+    }
+    fflush(stdout);
+}
+
+// Tabla de escalado: mensajes/s de cada configuración de réplicas sobre la
+// misma carga, la aceleración respecto de la primera y la eficiencia (la
+// aceleración dividida por cuántos procesos cliente más se usaron).
+void reportar_escalado(enum transporte tipo, int configuraciones[][NUM_ETAPAS], int num_configuraciones,
+                       const double *mensajes_s) {
+    int base = configuraciones[0][0] + configuraciones[0][1] + configuraciones[0][2];
+    printf("Escalado [%s, lote %d]:\n", nombre_transporte(tipo), lote);
+    printf("  %-11s %8s %12s %13s %10s\n", "réplicas", "clientes", "mensajes/s", "aceleración", "eficiencia");
+    for (int i = 0; i < num_configuraciones; i++) {
+        int *c = configuraciones[i];
+        int clientes = c[0] + c[1] + c[2];
+        double aceleracion = mensajes_s[0] > 0 ? mensajes_s[i] / mensajes_s[0] : 0.0;
+        char texto[16];
+        snprintf(texto, sizeof(texto), "%dx%dx%d", c[0], c[1], c[2]);
+        printf("  %-10s %8d %12.0f %11.2fx %9.0f%%\n", texto, clientes, mensajes_s[i], aceleracion,
+               100.0 * aceleracion * base / clientes);
+    }
+    fflush(stdout);
+}
+
+// ---------------------------------------------------------------------------
+// Arranque de las etapas en modo flujo (--arranque):
+//   fork:    un fork() por réplica en cada corrida, como siempre.
+//   spawn:   posix_spawn() del propio ejecutable con --etapa. glibc lo hace con
+//            clone(CLONE_VM | CLONE_VFORK), sin copiar la tabla de páginas del
+//            servidor, así que el costo no crece con su memoria. El hijo empieza
+//            de cero y mapea por nombre lo que con fork() heredaría.
+//   reserva: trabajadores creados una sola vez, antes de abrir la entrada, que
+//            esperan en su puesto. Cada corrida sólo les asigna etapa y réplica;
+//            al terminar el flujo vuelven a esperar en vez de salir.
+// ---------------------------------------------------------------------------
+
+const kernel_t kernels_etapa[NUM_ETAPAS] = { encrypt_buffer, reverse_buffer, decrypt_buffer };
+
+// Ranura de estadísticas de la réplica 'replica' de la etapa 'etapa' (la 0 es
+// el servidor), en el mismo orden en que modo_flujo las nombra.
+int ranura_etapa(int etapa, int replica) {
+    int k = 1;
+    for (int e = 0; e < etapa; e++) k += replicas[e];
+    return k + replica;
+}
+
+// Un proceso que no heredó las regiones del servidor las mapea por nombre. Los
+// eventfd de los anillos sí sobreviven a exec (no son CLOEXEC), pero no existen
+// en un trabajador de la reserva, que se creó antes que ellos.
+void adjuntar_transporte(enum transporte tipo) {
+    if (tipo != TRANSPORTE_SHM) return;
+    if (mapear_anillos(0) == -1) {
+        fprintf(stderr, "Etapa: no se pudo mapear la región de anillos\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void soltar_transporte(enum transporte tipo) {
+    if (tipo != TRANSPORTE_SHM) return;
+    munmap(region_anillos, tam_region_anillos);
+    region_anillos = NULL;
+}
+
+void adjuntar_estadisticas(int indice) {
+    int fd = shm_open(SHM_ESTADISTICAS, O_RDWR, 0);
+    estadisticas = fd == -1 ? MAP_FAILED
+                            : mmap(NULL, sizeof(estadisticas_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd != -1) close(fd);
+    if (estadisticas == MAP_FAILED) {
+        perror("Etapa: mmap " SHM_ESTADISTICAS);
+        exit(EXIT_FAILURE);
+    }
+    ranura = &estadisticas->ranuras[indice];
+    atomic_store_explicit(&ranura->pid, getpid(), memory_order_relaxed);
+}
+
+void soltar_estadisticas(void) {
+    munmap(estadisticas, sizeof(estadisticas_t));
+    estadisticas = NULL;
+    ranura = &ranura_local;
+}
+
+// Lanza la réplica 'replica' de la etapa 'etapa' con posix_spawn. El hijo recibe
+// por argumentos la configuración de la corrida y el descriptor (heredado) del
+// memfd de la barrera, porque un mapeo anónimo no sobrevive a exec.
+pid_t lanzar_etapa(enum transporte tipo, int etapa, int replica, int fd_barrera, FILE *entrada) {
+    char descripcion[64], texto_lote[16], texto_espera[24];
+    snprintf(descripcion, sizeof(descripcion), "%d:%d:%d:%d", etapa, replica, (int)tipo, fd_barrera);
+    snprintf(texto_lote, sizeof(texto_lote), "%d", lote);
+    snprintf(texto_espera, sizeof(texto_espera), "%ld", espera_lote_us);
+    char texto_carga[16];
+    snprintf(texto_carga, sizeof(texto_carga), "%u", carga_bitacora);
+    char *args[] = { "server", "--etapa", descripcion, "--lote", texto_lote, "--espera-lote", texto_espera,
+                     "--replicas", (char *)texto_replicas(), "--es", (char *)nombre_motor_es(motor_es),
+                     "--nivel-bitacora", (char *)nombre_nivel_bitacora(nivel_bitacora),
+                     "--carga-bitacora", texto_carga, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    int n = 15;
+    if (ruta_bitacora != NULL) {
+        args[n++] = "--bitacora";
+        args[n++] = (char *)ruta_bitacora;
+    }
+    char texto_prioridad[16];
+    if (texto_cpus != NULL) {
+        args[n++] = "--cpus";
+        args[n++] = (char *)texto_cpus;
+    }
+    if (prioridad_fifo > 0) {
+        snprintf(texto_prioridad, sizeof(texto_prioridad), "%d", prioridad_fifo);
+        args[n++] = "--prioridad-fifo";
+        args[n++] = texto_prioridad;
+    }
+    if (paginas_enormes) args[n++] = "--paginas-enormes";
+
+    posix_spawn_file_actions_t acciones;
+    posix_spawn_file_actions_init(&acciones);
+    if (entrada != stdin) posix_spawn_file_actions_addclose(&acciones, fileno(entrada));
+    pid_t pid;
+    int error = posix_spawn(&pid, "/proc/self/exe", &acciones, NULL, args, environ);
+    posix_spawn_file_actions_destroy(&acciones);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return pid;
+}
+
+// Punto de entrada de una etapa lanzada con posix_spawn (--etapa).
+int etapa_lanzada(const char *descripcion) {
+    int etapa, replica, tipo, fd_barrera;
+    if (sscanf(descripcion, "%d:%d:%d:%d", &etapa, &replica, &tipo, &fd_barrera) != 4 ||
+        etapa < 0 || etapa >= NUM_ETAPAS || replica < 0 || replica >= replicas[etapa] ||
+        (tipo != TRANSPORTE_FIFO && tipo != TRANSPORTE_SHM)) {
+        fprintf(stderr, "Etapa: descripción inválida '%s'\n", descripcion);
+        return EXIT_FAILURE;
+    }
+    preparar_canales();
+    procesos_flujo = 1 + replicas[0] + replicas[1] + replicas[2];
+    barrera = mmap(NULL, sizeof(evento_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd_barrera, 0);
+    close(fd_barrera);
+    if (barrera == MAP_FAILED) {
+        perror("Etapa: mmap barrera");
+        return EXIT_FAILURE;
+    }
+    adjuntar_transporte(tipo);
+    int indice = ranura_etapa(etapa, replica);
+    adjuntar_estadisticas(indice);
+    etapa_flujo(estadisticas->ranuras[indice].nombre, tipo, etapa, replica, kernels_etapa[etapa]);
+    return EXIT_SUCCESS;
+}
+
+// Puesto de un trabajador de la reserva: el servidor escribe el trabajo y
+// notifica 'asignado'; el trabajador deja ahí la CPU que usó.
+typedef struct {
+    evento_t asignado;
+    pid_t pid;
+    int terminar;
+    enum transporte tipo;
+    int etapa, replica, lote;
+    long espera_lote_us;
+    enum motor_es es;
+    int replicas[NUM_ETAPAS];
+    double cpu;                 // Segundos de CPU del último trabajo
+} puesto_t;
+
+typedef struct {
+    evento_t barrera;           // La barrera de cada corrida (se reinicia en cada una)
+    evento_t terminados;        // Cada trabajador lo notifica al terminar su etapa
+    int num_puestos;
+    puesto_t puestos[NUM_ETAPAS * MAX_REPLICAS];
+} reserva_t;
+
+reserva_t *reserva = NULL;
+
+void trabajador_reserva(puesto_t *p) {
+    signal(SIGPIPE, SIG_IGN); // Como las etapas de modo_flujo: se reporta el error de write
+    uint32_t visto = 0, valor;
+    for (;;) {
+        while ((valor = evento_valor(&p->asignado)) == visto) evento_esperar(&p->asignado, valor);
+        visto = valor;
+        if (p->terminar) exit(EXIT_SUCCESS);
+
+        lote = p->lote;
+        espera_lote_us = p->espera_lote_us;
+        motor_es = p->es;
+        memcpy(replicas, p->replicas, sizeof(replicas));
+        preparar_canales();
+        procesos_flujo = 1 + replicas[0] + replicas[1] + replicas[2];
+        barrera = &reserva->barrera;
+
+        struct rusage uso;
+        getrusage(RUSAGE_SELF, &uso);
+        double cpu_inicial = segundos_cpu(&uso);
+        adjuntar_transporte(p->tipo);
+        int indice = ranura_etapa(p->etapa, p->replica);
+        adjuntar_estadisticas(indice);
+        etapa_flujo(estadisticas->ranuras[indice].nombre, p->tipo, p->etapa, p->replica,
+                    kernels_etapa[p->etapa]);
+        soltar_estadisticas();
+        soltar_transporte(p->tipo);
+        getrusage(RUSAGE_SELF, &uso);
+        p->cpu = segundos_cpu(&uso) - cpu_inicial;
+        evento_notificar(&reserva->terminados);
+    }
+}
+
+// Completa la reserva hasta 'n' trabajadores. Cada uno muere con el servidor
+// (PR_SET_PDEATHSIG) para no quedar esperando si éste sale por un error.
+void reserva_preparar(int n) {
+    if (reserva == NULL) {
+        reserva = mmap(NULL, sizeof(reserva_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (reserva == MAP_FAILED) {
+            perror("Servidor: mmap reserva");
+            exit(EXIT_FAILURE);
+        }
+        evento_iniciar(&reserva->terminados, NOTIFICACION_FUTEX, giros_notificacion);
+    }
+    pid_t servidor = getpid();
+    fflush(stdout);
+    while (reserva->num_puestos < n) {
+        puesto_t *p = &reserva->puestos[reserva->num_puestos];
+        evento_iniciar(&p->asignado, NOTIFICACION_FUTEX, 0);
+        // El puesto es compartido: sólo el padre escribe el pid.
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != servidor) exit(EXIT_FAILURE); // El servidor ya había salido
+            trabajador_reserva(p);
+        }
+        p->pid = pid;
+        reserva->num_puestos++;
+    }
+}
+
+// Termina los trabajadores. Con 'forzar' (tras un error, cuando alguno puede
+// seguir bloqueado en un canal) se los mata en vez de pedirles que salgan.
+void reserva_cerrar(int forzar) {
+    if (reserva == NULL) return;
+    for (int i = 0; i < reserva->num_puestos; i++) {
+        puesto_t *p = &reserva->puestos[i];
+        if (forzar) {
+            kill(p->pid, SIGTERM);
+        } else {
+            p->terminar = 1;
+            evento_notificar(&p->asignado);
+        }
+    }
+    for (int i = 0; i < reserva->num_puestos; i++) waitpid(reserva->puestos[i].pid, NULL, 0);
+    munmap(reserva, sizeof(reserva_t));
+    reserva = NULL;
+}
+
+// Mensaje enviado cuyo resultado todavía no volvió; guarda la cadena esperada
+// (la original invertida) o, con --verificacion crc, sólo su CRC32C.
+typedef struct {
+    char *esperado;
+    uint32_t crc;
+    size_t longitud;
+    double llegada;   // Para la latencia de extremo a extremo, incluida la espera en la cola
+    int sesion;                 // Con el frontal: a qué conexión vuelve el resultado; si no, -1
+    unsigned long id_sesion;
+    uint32_t pedido;
+} en_vuelo_t;
+
+// Mensaje admitido que espera crédito para entrar al pipeline.
+typedef struct {
+    char *linea;
+    size_t tam_linea;           // Lo reservado por getline, para reutilizar el búfer
+    size_t longitud;
+    double llegada;
+    unsigned long numero;       // Orden de llegada
+    int sesion;                 // Como en en_vuelo_t
+    unsigned long id_sesion;
+    uint32_t pedido;
+} pendiente_t;
+
+// Cola de admisión: un anillo de a lo sumo 'capacidad' mensajes y bytes_cola bytes.
+typedef struct {
+    pendiente_t *mensajes;
+    int capacidad, inicio, num;
+    size_t bytes;
+    unsigned long llegados, descartados, rechazados;
+    int maximo;
+    double suma_ocupacion;      // Ocupación que encontró cada llegada, para la media
+} cola_t;
+
+// La entrada del modo flujo vista como una fuente de llegadas.
+typedef struct {
+    FILE *archivo;
+    int agotada;
+    char *linea;                // Línea leída que todavía no entró a la cola
+    size_t tam_linea;
+    size_t longitud;            // 0 si no hay línea retenida
+    double llegada;
+    double inicio;              // Referencia de las llegadas a ritmo fijo
+    unsigned long leidas;
+} fuente_t;
+
+// Un mensaje más grande que bytes_cola entra igual si la cola está vacía.
+int cola_cabe(const cola_t *c, size_t longitud) {
+    return c->num < c->capacidad && (c->num == 0 || c->bytes + longitud <= bytes_cola);
+}
+
+pendiente_t *cola_primero(cola_t *c) {
+    return &c->mensajes[c->inicio];
+}
+
+void cola_sacar(cola_t *c) {
+    c->bytes -= c->mensajes[c->inicio].longitud;
+    c->inicio = (c->inicio + 1) % c->capacidad;
+    c->num--;
+}
+
+// Hora a la que llega el mensaje k con --llegadas.
+double hora_llegada(const fuente_t *f, unsigned long k) {
+    return f->inicio + (double)(k / rafaga_llegadas) * rafaga_llegadas / ritmo_llegadas;
+}
+
+// ---------------------------------------------------------------------------
+// Frontal de productores (--escuchar): el servidor acepta conexiones en un
+// socket Unix y cada una es una sesión que envía líneas y recibe, por la misma
+// conexión y en el mismo orden, una línea de respuesta por cada una: el
+// resultado del pipeline o, si la política de sobrecarga no la dejó entrar,
+// "!descartado" o "!rechazado" (las líneas vacías se ignoran). Todas las sesiones comparten la cola de
+// admisión, los créditos y las mismas etapas; cada pedido lleva la sesión
+// (índice e identificador) y su número dentro de ella hasta que vuelve.
+//
+// Un solo hilo atiende todo con epoll: el socket de escucha, las sesiones (por
+// flanco, sin volver a registrarlas al cambiar de estado) y el canal de
+// resultados. Las sesiones con líneas por admitir esperan su turno en una
+// lista y pasan de a una línea por turno, así ninguna acapara la cola.
+//
+// La memoria por conexión está acotada: ENTRADA_SESION bytes de entrada (y la
+// línea más larga que se acepta), SALIDA_SESION de salida y PEDIDOS_SESION
+// pedidos sin responder. Un pedido sólo se admite si su respuesta ya tiene
+// lugar reservado en la salida; una sesión sin lugar deja de leerse hasta que
+// su productor lea respuestas, sin frenar a las demás.
+// ---------------------------------------------------------------------------
+
+#define ENTRADA_SESION 4096
+#define SALIDA_SESION (16 * 1024)
+#define PEDIDOS_SESION 64
+#define EVENTOS_FRONTAL 256
+#define ETIQUETA_ESCUCHA UINT64_MAX
+#define ETIQUETA_RESULTADO (UINT64_MAX - 1)
+
+enum respuesta { RESPUESTA_PENDIENTE, RESPUESTA_DESCARTADA, RESPUESTA_RECHAZADA };
+const char *marcas_respuesta[] = { NULL, "!descartado\n", "!rechazado\n" };
+#define TAM_MARCA 12
+
+typedef struct {
+    int fd;                         // -1: ranura libre
+    unsigned long id;               // Identificador de la sesión, único en la corrida
+    char *entrada, *salida;
+    size_t entrada_inicio, entrada_fin, salida_inicio, salida_fin;
+    size_t reservado;               // Lugar de 'salida' comprometido con pedidos sin responder
+    uint32_t primero, siguiente;    // Pedidos sin responder: [primero, siguiente)
+    uint8_t estados[PEDIDOS_SESION];
+    uint16_t reservas[PEDIDOS_SESION];
+    int por_leer;                   // Puede haber datos en el socket que todavía no se leyeron
+    int fin;                        // El productor ya no envía más
+    int en_turno;                   // Está en la lista de sesiones por admitir
+    int detenida;                   // Sin lugar para otro pedido hasta que salgan respuestas
+} sesion_t;
+
+typedef struct {
+    int epoll, escucha, escuchando;
+    int fd_resultado;               // Canal de resultados vigilado por epoll
+    sesion_t *sesiones;
+    int capacidad, activas, maximo_activas;
+    int *libres, num_libres;
+    int *turnos, turno_inicio, num_turnos;
+    int terminando;
+    unsigned long aceptadas, huerfanos;
+    sigset_t mascara;               // La de epoll_pwait: SIGINT y SIGTERM sólo llegan ahí
+    sigset_t mascara_anterior;
+} frontal_t;
+
+frontal_t *frontal = NULL;
+volatile sig_atomic_t terminar_frontal = 0;
+
+void pedir_terminar_frontal(int senal) {
+    (void)senal;
+    terminar_frontal = 1;
+}
+
+// Lugar que reserva en la salida un pedido de 'longitud' bytes: su respuesta o una marca.
+size_t reserva_respuesta(size_t longitud) {
+    return longitud + 1 > TAM_MARCA ? longitud + 1 : TAM_MARCA;
+}
+
+int sesion_cabe(const sesion_t *s, size_t longitud) {
+    return s->siguiente - s->primero < PEDIDOS_SESION &&
+           s->reservado + (s->salida_fin - s->salida_inicio) + reserva_respuesta(longitud) <= SALIDA_SESION;
+}
+
+void frontal_turno(int i) {
+    sesion_t *s = &frontal->sesiones[i];
+    if (s->en_turno || s->fd == -1) return;
+    frontal->turnos[(frontal->turno_inicio + frontal->num_turnos) % frontal->capacidad] = i;
+    frontal->num_turnos++;
+    s->en_turno = 1;
+}
+
+// Devuelve la ranura de una sesión cerrada; si se había dejado de escuchar por
+// falta de ranuras, se vuelve a aceptar.
+void frontal_liberar(int i) {
+    frontal->libres[frontal->num_libres++] = i;
+    if (!frontal->escuchando && !frontal->terminando) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u64 = ETIQUETA_ESCUCHA };
+        if (epoll_ctl(frontal->epoll, EPOLL_CTL_ADD, frontal->escucha, &ev) == 0) frontal->escuchando = 1;
+    }
+}
+
+void frontal_cerrar_sesion(int i, int error) {
+    sesion_t *s = &frontal->sesiones[i];
+    if (s->fd == -1) return;
+    bitacora_registrar(BITACORA_DEPURACION, EVENTO_DESCONEXION, s->id, error, NULL, 0);
+    close(s->fd); // También la quita de epoll
+    free(s->entrada);
+    free(s->salida);
+    s->fd = -1;
+    s->entrada = s->salida = NULL;
+    frontal->activas--;
+    // Si está en la lista de turnos, la ranura se libera al salir de ella.
+    if (!s->en_turno) frontal_liberar(i);
+}
+
+// Cierra la sesión cuando el productor terminó y ya tiene todas sus respuestas.
+void frontal_quizas_terminar(int i) {
+    sesion_t *s = &frontal->sesiones[i];
+    if (s->fd != -1 && s->fin && s->primero == s->siguiente && s->salida_inicio == s->salida_fin &&
+        s->entrada_inicio == s->entrada_fin) {
+        frontal_cerrar_sesion(i, 0);
+    }
+}
+
+// Envía lo que se pueda de la salida sin bloquear; el resto sale con EPOLLOUT.
+void frontal_escribir(int i) {
+    sesion_t *s = &frontal->sesiones[i];
+    while (s->fd != -1 && s->salida_inicio < s->salida_fin) {
+        estadistica_sumar(&ranura->llamadas, 1);
+        ssize_t r = send(s->fd, s->salida + s->salida_inicio, s->salida_fin - s->salida_inicio,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (r >= 0) {
+            s->salida_inicio += r;
+        } else if (errno == EAGAIN) {
+            break;
+        } else if (errno != EINTR) {
+            frontal_cerrar_sesion(i, errno);
+            return;
+        }
+    }
+    if (s->fd == -1) return;
+    if (s->salida_inicio == s->salida_fin) s->salida_inicio = s->salida_fin = 0;
+    if (s->detenida) {
+        s->detenida = 0; // frontal_admitir vuelve a probar la línea retenida
+        frontal_turno(i);
+    }
+    frontal_quizas_terminar(i);
+}
+
+void sesion_agregar(sesion_t *s, const void *datos, size_t n) {
+    if (s->salida_fin + n > SALIDA_SESION) {
+        memmove(s->salida, s->salida + s->salida_inicio, s->salida_fin - s->salida_inicio);
+        s->salida_fin -= s->salida_inicio;
+        s->salida_inicio = 0;
+    }
+    memcpy(s->salida + s->salida_fin, datos, n);
+    s->salida_fin += n;
+}
+
+// Pasa a la salida, en orden, las marcas de los pedidos que ya no esperan resultado.
+void sesion_emitir_marcas(sesion_t *s) {
+    while (s->primero != s->siguiente && s->estados[s->primero % PEDIDOS_SESION] != RESPUESTA_PENDIENTE) {
+        uint32_t k = s->primero % PEDIDOS_SESION;
+        sesion_agregar(s, marcas_respuesta[s->estados[k]], strlen(marcas_respuesta[s->estados[k]]));
+        s->reservado -= s->reservas[k];
+        s->primero++;
+    }
+}
+
+// El pedido no va a tener resultado: su marca sale en cuanto le toque.
+void frontal_marcar(int i, unsigned long id, uint32_t pedido, enum respuesta r) {
+    sesion_t *s = &frontal->sesiones[i];
+    if (s->fd == -1 || s->id != id) return;
+    s->estados[pedido % PEDIDOS_SESION] = r;
+    if (pedido != s->primero) return;
+    sesion_emitir_marcas(s);
+    frontal_escribir(i);
+}
+
+// Entrega el resultado de 'e' a su sesión. El pipeline conserva el orden y sólo
+// se descartan pedidos que todavía no entraron, así que cuando llega un
+// resultado todos los pedidos anteriores de la sesión ya tienen respuesta.
+void frontal_responder(const en_vuelo_t *e, const char *resultado) {
+    sesion_t *s = &frontal->sesiones[e->sesion];
+    if (s->fd == -1 || s->id != e->id_sesion) {
+        frontal->huerfanos++; // La sesión se cerró antes de que volviera
+        return;
+    }
+    uint32_t k = e->pedido % PEDIDOS_SESION;
+    sesion_agregar(s, resultado, e->longitud);
+    sesion_agregar(s, "\n", 1);
+    s->reservado -= s->reservas[k];
+    s->primero++;
+    sesion_emitir_marcas(s);
+    frontal_escribir(e->sesion);
+}
+
+// Deja en *longitud el largo de la próxima línea completa de la sesión, leyendo
+// del socket si hace falta. Devuelve 1 si hay una línea, 0 si hay que esperar
+// más datos (o la sesión terminó) y -1 ante un error o una línea demasiado larga.
+int sesion_linea(sesion_t *s, size_t *longitud) {
+    for (;;) {
+        char *inicio = s->entrada + s->entrada_inicio;
+        char *nl = memchr(inicio, '\n', s->entrada_fin - s->entrada_inicio);
+        if (nl != NULL) {
+            *longitud = nl - inicio;
+            return 1;
+        }
+        if (!s->por_leer) return 0;
+        if (s->entrada_inicio > 0) {
+            memmove(s->entrada, inicio, s->entrada_fin - s->entrada_inicio);
+            s->entrada_fin -= s->entrada_inicio;
+            s->entrada_inicio = 0;
+        }
+        if (s->entrada_fin == ENTRADA_SESION) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        estadistica_sumar(&ranura->llamadas, 1);
+        ssize_t r = read(s->fd, s->entrada + s->entrada_fin, ENTRADA_SESION - s->entrada_fin);
+        if (r > 0) {
+            s->entrada_fin += r;
+        } else if (r == 0) {
+            // Una última línea sin '\n' también es un pedido.
+            s->fin = 1;
+            s->por_leer = 0;
+            if (s->entrada_fin > s->entrada_inicio) s->entrada[s->entrada_fin++] = '\n';
+        } else if (errno == EAGAIN) {
+            s->por_leer = 0;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+// Acepta conexiones mientras haya ranuras; sin ranuras deja de escuchar y los
+// productores esperan en la cola de listen() hasta que se cierre una sesión.
+void frontal_aceptar(void) {
+    frontal_t *f = frontal;
+    while (f->num_libres > 0) {
+        estadistica_sumar(&ranura->llamadas, 1);
+        int fd = accept4(f->escucha, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN) perror("Servidor: accept");
+            return;
+        }
+        int i = f->libres[--f->num_libres];
+        sesion_t *s = &f->sesiones[i];
+        memset(s, 0, sizeof(*s));
+        s->fd = fd;
+        s->id = ++f->aceptadas;
+        s->entrada = malloc(ENTRADA_SESION);
+        s->salida = malloc(SALIDA_SESION);
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.u64 = i };
+        if (s->entrada == NULL || s->salida == NULL || epoll_ctl(f->epoll, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            perror("Servidor: nueva sesión");
+            f->activas++;
+            frontal_cerrar_sesion(i, errno);
+            continue;
+        }
+        bitacora_registrar(BITACORA_DEPURACION, EVENTO_CONEXION, s->id, 0, NULL, 0);
+        if (++f->activas > f->maximo_activas) f->maximo_activas = f->activas;
+        s->por_leer = 1; // Puede haber escrito antes del registro en epoll
+        frontal_turno(i);
+    }
+    if (f->escuchando && epoll_ctl(f->epoll, EPOLL_CTL_DEL, f->escucha, NULL) == 0) f->escuchando = 0;
+}
+
+// Deja de aceptar y de admitir; lo que ya está en la cola o en vuelo termina y
+// se responde.
+void frontal_terminar(void) {
+    frontal->terminando = 1;
+    close(frontal->escucha);
+    unlink(ruta_escucha);
+    frontal->escuchando = 0;
+}
+
+int frontal_abrir(int capacidad) {
+    frontal_t *f = calloc(1, sizeof(frontal_t));
+    if (f == NULL) return -1;
+    f->capacidad = capacidad;
+    f->fd_resultado = -1;
+    f->sesiones = calloc(capacidad, sizeof(sesion_t));
+    f->libres = malloc(capacidad * sizeof(int));
+    f->turnos = malloc(capacidad * sizeof(int));
+    if (f->sesiones == NULL || f->libres == NULL || f->turnos == NULL) return -1;
+    for (int i = 0; i < capacidad; i++) {
+        f->sesiones[i].fd = -1;
+        f->libres[i] = capacidad - 1 - i;
+    }
+    f->num_libres = capacidad;
+
+    // Un descriptor por conexión: se sube el límite blando hasta donde deje el duro.
+    struct rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < (rlim_t)capacidad + 64) {
+        limite.rlim_cur = limite.rlim_max < (rlim_t)capacidad + 64 ? limite.rlim_max : (rlim_t)capacidad + 64;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+
+    struct sockaddr_un direccion = { .sun_family = AF_UNIX };
+    if (strlen(ruta_escucha) >= sizeof(direccion.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(direccion.sun_path, ruta_escucha);
+    unlink(ruta_escucha);
+    if ((f->escucha = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1 ||
+        bind(f->escucha, (struct sockaddr *)&direccion, sizeof(direccion)) == -1 ||
+        listen(f->escucha, SOMAXCONN) == -1 || (f->epoll = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        return -1;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = ETIQUETA_ESCUCHA };
+    if (epoll_ctl(f->epoll, EPOLL_CTL_ADD, f->escucha, &ev) == -1) return -1;
+    f->escuchando = 1;
+
+    // SIGINT y SIGTERM terminan la corrida ordenadamente: fuera de epoll_pwait
+    // están bloqueadas, así no interrumpen una read() o write() de los canales.
+    struct sigaction accion = { .sa_handler = pedir_terminar_frontal };
+    sigemptyset(&accion.sa_mask);
+    sigaction(SIGINT, &accion, NULL);
+    sigaction(SIGTERM, &accion, NULL);
+    sigset_t bloqueadas;
+    sigemptyset(&bloqueadas);
+    sigaddset(&bloqueadas, SIGINT);
+    sigaddset(&bloqueadas, SIGTERM);
+    sigprocmask(SIG_BLOCK, &bloqueadas, &f->mascara_anterior);
+    f->mascara = f->mascara_anterior;
+    sigdelset(&f->mascara, SIGINT);
+    sigdelset(&f->mascara, SIGTERM);
+    terminar_frontal = 0;
+    frontal = f;
+    return 0;
+}
+
+// Responde lo que se pueda sin bloquear y cierra todas las sesiones.
+void frontal_cerrar(void) {
+    frontal_t *f = frontal;
+    if (f == NULL) return;
+    for (int i = 0; i < f->capacidad; i++) {
+        if (f->sesiones[i].fd == -1) continue;
+        frontal_escribir(i);
+        frontal_cerrar_sesion(i, 0);
+    }
+    if (!f->terminando) frontal_terminar();
+    close(f->epoll);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    sigprocmask(SIG_SETMASK, &f->mascara_anterior, NULL);
+    free(f->sesiones);
+    free(f->libres);
+    free(f->turnos);
+    free(f);
+    frontal = NULL;
+}
+
+// Hace lugar en la cola para una llegada de 'longitud' bytes según la política
+// de sobrecarga. Devuelve 1 si ya cabe (quizás tras descartar los más viejos),
+// 0 si la llegada se descarta o se rechaza (ya contada y anotada) y -1 si hay
+// que bloquear: la llegada espera fuera de la cola.
+int cola_hacer_lugar(cola_t *c, size_t longitud, unsigned long numero) {
+    if (cola_cabe(c, longitud)) return 1;
+    if (sobrecarga == SOBRECARGA_BLOQUEAR) return -1;
+    if (sobrecarga != SOBRECARGA_DESCARTAR_VIEJO) {
+        int rechazo = sobrecarga == SOBRECARGA_RECHAZAR;
+        if (rechazo) c->rechazados++;
+        else c->descartados++;
+        bitacora_registrar(BITACORA_DEPURACION, rechazo ? EVENTO_RECHAZADO : EVENTO_DESCARTADO, numero, longitud,
+                           NULL, 0);
+        return 0;
+    }
+    while (!cola_cabe(c, longitud)) {
+        pendiente_t *viejo = cola_primero(c);
+        c->descartados++;
+        bitacora_registrar(BITACORA_DEPURACION, EVENTO_DESCARTADO, viejo->numero, viejo->longitud, NULL, 0);
+        if (viejo->sesion >= 0) frontal_marcar(viejo->sesion, viejo->id_sesion, viejo->pedido, RESPUESTA_DESCARTADA);
+        free(viejo->linea);
+        cola_sacar(c);
+    }
+    return 1;
+}
+
+void cola_meter(cola_t *c, const pendiente_t *p) {
+    c->mensajes[(c->inicio + c->num) % c->capacidad] = *p;
+    c->num++;
+    c->bytes += p->longitud;
+    if (c->num > c->maximo) c->maximo = c->num;
+}
+
+// Pasa a la cola los mensajes que ya llegaron y aplica la política de sobrecarga
+// a los que no caben.
+void admitir_llegadas(fuente_t *f, cola_t *c) {
+    for (;;) {
+        if (f->longitud == 0) {
+            if (f->agotada) return;
+            if (ritmo_llegadas > 0 && hora_llegada(f, f->leidas) > tiempo_actual()) return;
+            // Bloquear es no leer: lo que no entra se queda en la entrada.
+            if (sobrecarga == SOBRECARGA_BLOQUEAR && c->num == c->capacidad) return;
+            ssize_t n = getline(&f->linea, &f->tam_linea, f->archivo);
+            if (n == -1) {
+                f->agotada = 1;
+                return;
+            }
+            if (n > 0 && f->linea[n - 1] == '\n') f->linea[--n] = '\0';
+            if (n == 0) continue; // Las etapas rechazan cadenas vacías
+            f->longitud = n;
+            f->llegada = ritmo_llegadas > 0 ? hora_llegada(f, f->leidas) : tiempo_actual();
+            f->leidas++;
+            c->llegados++;
+            c->suma_ocupacion += c->num;
+        }
+        int lugar = cola_hacer_lugar(c, f->longitud, f->leidas - 1);
+        if (lugar == -1) return; // Queda retenida hasta que haya lugar
+        if (lugar == 1) {
+            cola_meter(c, &(pendiente_t){ .linea = f->linea, .tam_linea = f->tam_linea, .longitud = f->longitud,
+                                          .llegada = f->llegada, .numero = f->leidas - 1, .sesion = -1 });
+            f->linea = NULL;
+            f->tam_linea = 0;
+        }
+        f->longitud = 0; // Si se descartó, el búfer se reutiliza para la próxima línea
+    }
+}
+
+// Como admitir_llegadas, con las líneas de las sesiones del frontal: de a una
+// por turno, mientras la cola las acepte.
+void frontal_admitir(cola_t *c) {
+    frontal_t *f = frontal;
+    while (f->num_turnos > 0 && !f->terminando) {
+        int i = f->turnos[f->turno_inicio];
+        sesion_t *s = &f->sesiones[i];
+        size_t n = 0;
+        int r = s->fd == -1 ? 0 : sesion_linea(s, &n);
+        if (r == 1 && !sesion_cabe(s, n)) {
+            s->detenida = 1; // La línea queda en la entrada hasta que salgan respuestas
+            r = 0;
+        }
+        // Bloquear es no leer: la sesión conserva su turno y su línea.
+        if (r == 1 && n > 0 && sobrecarga == SOBRECARGA_BLOQUEAR && !cola_cabe(c, n)) return;
+        f->turno_inicio = (f->turno_inicio + 1) % f->capacidad;
+        f->num_turnos--;
+        s->en_turno = 0;
+        if (s->fd == -1) {
+            frontal_liberar(i);
+            continue;
+        }
+        if (r == -1) {
+            frontal_cerrar_sesion(i, errno);
+            continue;
+        }
+        if (r == 0) {
+            frontal_quizas_terminar(i);
+            continue;
+        }
+        char *linea = s->entrada + s->entrada_inicio;
+        s->entrada_inicio += n + 1;
+        frontal_turno(i); // Al final de la lista: puede tener más líneas
+        if (n == 0) continue; // Las etapas rechazan cadenas vacías
+
+        uint32_t pedido = s->siguiente++;
+        uint32_t k = pedido % PEDIDOS_SESION;
+        s->estados[k] = RESPUESTA_PENDIENTE;
+        s->reservas[k] = reserva_respuesta(n);
+        s->reservado += s->reservas[k];
+        c->llegados++;
+        c->suma_ocupacion += c->num;
+        // Se copia antes de hacer lugar: descartar otro pedido puede escribir en
+        // esta misma sesión y, si falla, cerrarla.
+        char *copia = malloc(n);
+        if (copia == NULL) {
+            perror("Servidor: malloc");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(copia, linea, n);
+        unsigned long id = s->id;
+        if (cola_hacer_lugar(c, n, c->llegados - 1) == 1) {
+            cola_meter(c, &(pendiente_t){ .linea = copia, .tam_linea = n, .longitud = n, .llegada = tiempo_actual(),
+                                          .numero = c->llegados - 1, .sesion = i, .id_sesion = id, .pedido = pedido });
+        } else {
+            free(copia);
+            frontal_marcar(i, id, pedido, sobrecarga == SOBRECARGA_RECHAZAR ? RESPUESTA_RECHAZADA : RESPUESTA_DESCARTADA);
+        }
+    }
+}
+
+// Espera en epoll a que pase algo: una conexión, datos o lugar en una sesión,
+// o un resultado en 'resultado'. Los lotes pendientes de 'salidas' salen antes
+// de dormir: mientras haya eventos listos siguen juntando mensajes. Devuelve 1
+// si hay un resultado para leer, 0 si no y -1 ante un error.
+int frontal_esperar(canal_t *resultado, canal_t *salidas, int num_salidas) {
+    frontal_t *f = frontal;
+    if (resultado->lectura_inicio < resultado->lectura_fin) return 1;
+    if (resultado->fd != f->fd_resultado) {
+        // Con réplicas del Cliente 3 el resultado siguiente llega por otro canal.
+        struct epoll_event ev = { .events = EPOLLIN, .data.u64 = ETIQUETA_RESULTADO };
+        if (f->fd_resultado != -1) epoll_ctl(f->epoll, EPOLL_CTL_DEL, f->fd_resultado, NULL);
+        if (epoll_ctl(f->epoll, EPOLL_CTL_ADD, resultado->fd, &ev) == -1) return -1;
+        f->fd_resultado = resultado->fd;
+    }
+    int pendientes = 0;
+    for (int i = 0; i < num_salidas; i++) pendientes |= salidas[i].escritura != NULL && salidas[i].escritura_usada > 0;
 
-// PIDs de los procesos hijos (necesarios para enviar señales)
-pid_t client1_pid, client2_pid, client3_pid;
+    struct epoll_event eventos[EVENTOS_FRONTAL];
+    int n;
+    for (;;) {
+        estadistica_sumar(&ranura->llamadas, 1);
+        uint64_t t0 = reloj_ns();
+        n = epoll_pwait(f->epoll, eventos, EVENTOS_FRONTAL, pendientes ? 0 : -1, &f->mascara);
+        estadistica_sumar(&ranura->ns_lectura, reloj_ns() - t0);
+        if (n == -1 && errno != EINTR) return -1;
+        if (terminar_frontal && !f->terminando) frontal_terminar();
+        if (n != 0) break;
+        for (int i = 0; i < num_salidas; i++) {
+            if (canal_vaciar(&salidas[i]) == -1) return -1;
+        }
+        pendientes = 0;
+    }
+    int listo = 0;
+    for (int k = 0; k < n; k++) {
+        uint64_t etiqueta = eventos[k].data.u64;
+        if (etiqueta == ETIQUETA_RESULTADO) {
+            listo = 1;
+        } else if (etiqueta == ETIQUETA_ESCUCHA) {
+            if (!f->terminando) frontal_aceptar();
+        } else {
+            int i = (int)etiqueta;
+            if (f->sesiones[i].fd == -1) continue;
+            if (eventos[k].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                f->sesiones[i].por_leer = 1;
+                frontal_turno(i);
+            }
+            if (eventos[k].events & EPOLLOUT) frontal_escribir(i);
+        }
+    }
+    return listo;
+}
+
+// Servidor en modo flujo: crea el transporte y los clientes una sola vez, envía
+// cada línea de la entrada, verifica el mensaje de vuelta y reporta mensajes/s.
+int modo_flujo(FILE *entrada, enum transporte tipo, double *mensajes_s) {
+    canal_t canal_message[MAX_REPLICAS], canal_result[MAX_REPLICAS];
+    int indices_message[MAX_REPLICAS], indices_result[MAX_REPLICAS];
+    cabecera_t cabecera;
+    pid_t pids[NUM_ETAPAS * MAX_REPLICAS];
+    int etapa_pid[NUM_ETAPAS * MAX_REPLICAS];
+    int num_pids = 0;
+
+    // Un cliente caído no debe matar al servidor con SIGPIPE; se reporta el error de write.
+    signal(SIGPIPE, SIG_IGN);
+    preparar_canales();
+    crear_transporte(tipo);
+
+    // La barrera la comparten procesos que no la heredan con fork(): los de la
+    // reserva la tienen en su región y los lanzados con posix_spawn la mapean
+    // desde un memfd.
+    procesos_flujo = 1 + replicas[0] + replicas[1] + replicas[2];
+    int fd_barrera = -1;
+    if (arranque == ARRANQUE_RESERVA) {
+        reserva_preparar(procesos_flujo - 1);
+        barrera = &reserva->barrera;
+    } else if (arranque == ARRANQUE_SPAWN) {
+        if ((fd_barrera = memfd_create("so_l2_barrera", 0)) == -1 ||
+            ftruncate(fd_barrera, sizeof(evento_t)) == -1) {
+            perror("Servidor: memfd barrera");
+            exit(EXIT_FAILURE);
+        }
+        barrera = mmap(NULL, sizeof(evento_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd_barrera, 0);
+    } else {
+        barrera = mmap(NULL, sizeof(evento_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    if (barrera == MAP_FAILED) {
+        perror("Servidor: mmap barrera");
+        exit(EXIT_FAILURE);
+    }
+    evento_iniciar(barrera, NOTIFICACION_FUTEX, giros_notificacion);
+
+    // Una ranura de estadísticas por proceso: el servidor y cada réplica.
+    char nombres_ranuras[1 + NUM_ETAPAS * MAX_REPLICAS][16];
+    const char *nombres[1 + NUM_ETAPAS * MAX_REPLICAS] = { "Servidor" };
+    for (int e = 0, k = 1; e < NUM_ETAPAS; e++) {
+        for (int r = 0; r < replicas[e]; r++, k++) {
+            if (replicas[e] == 1) {
+                snprintf(nombres_ranuras[k], sizeof(nombres_ranuras[k]), "Cliente %d", e + 1);
+            } else {
+                snprintf(nombres_ranuras[k], sizeof(nombres_ranuras[k]), "Cliente %d.%d", e + 1, r);
+            }
+            nombres[k] = nombres_ranuras[k];
+        }
+    }
+    crear_estadisticas(tipo, nombres, procesos_flujo);
+
+    // El arranque se mide desde aquí: hasta que todas las etapas abrieron sus
+    // canales (la barrera) y hasta que vuelve el primer resultado.
+    double lanzamiento = tiempo_actual(), listo = 0.0, primer_resultado = 0.0;
+    uint32_t terminados_inicial = reserva != NULL ? evento_valor(&reserva->terminados) : 0;
+    fflush(stdout);
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        for (int r = 0; r < replicas[e]; r++) {
+            pid_t pid;
+            if (arranque == ARRANQUE_RESERVA) {
+                puesto_t *p = &reserva->puestos[num_pids];
+                p->tipo = tipo;
+                p->etapa = e;
+                p->replica = r;
+                p->lote = lote;
+                p->espera_lote_us = espera_lote_us;
+                p->es = motor_es;
+                memcpy(p->replicas, replicas, sizeof(p->replicas));
+                evento_notificar(&p->asignado);
+                pid = p->pid;
+            } else if (arranque == ARRANQUE_SPAWN) {
+                if ((pid = lanzar_etapa(tipo, e, r, fd_barrera, entrada)) == -1) {
+                    perror("posix_spawn");
+                    exit(EXIT_FAILURE);
+                }
+            } else if ((pid = fork()) < 0) {
+                perror("fork");
+                exit(EXIT_FAILURE);
+            } else if (pid == 0) {
+                if (entrada != stdin) fclose(entrada);
+                ranura = &estadisticas->ranuras[1 + num_pids];
+                atomic_store_explicit(&ranura->pid, getpid(), memory_order_relaxed);
+                etapa_flujo(nombres[1 + num_pids], tipo, e, r, kernels_etapa[e]);
+                exit(EXIT_SUCCESS);
+            }
+            etapa_pid[num_pids] = e;
+            pids[num_pids++] = pid;
+        }
+    }
+    if (fd_barrera != -1) close(fd_barrera);
+
+    int num_message = replicas[0], num_result = replicas[NUM_ETAPAS - 1];
+    for (int i = 0; i < num_message; i++) indices_message[i] = indice_canal(0, 0, i);
+    for (int i = 0; i < num_result; i++) indices_result[i] = indice_canal(NUM_TRAMOS - 1, i, 0);
+    const char *fallido;
+    if (abrir_canales(tipo, canal_result, indices_result, num_result,
+                      canal_message, indices_message, num_message, &fallido) == -1) {
+        fprintf(stderr, "Servidor: open %s: %s\n", fallido, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    listo = tiempo_actual() - lanzamiento;
+    bitacora_iniciar(0, 0, 1);
+    if (formato == FORMATO_TEXTO) {
+        printf("Servidor (PID: %d): Modo flujo sobre %s, ventana %d, lote %d, réplicas %s. %d clientes listos (%s).\n",
+               getpid(), nombre_transporte(tipo), ventana, lote, texto_replicas(), num_pids, nombre_arranque(arranque));
+    }
+    // El frontal se abre con las etapas ya lanzadas, así ellas no heredan el
+    // socket de escucha.
+    if (ruta_escucha != NULL) {
+        if (frontal_abrir(capacidad_conexiones) == -1) {
+            fprintf(stderr, "Servidor: escuchar en %s: %s\n", ruta_escucha, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        if (formato == FORMATO_TEXTO) {
+            printf("Servidor: escuchando productores en %s (hasta %d conexiones); SIGINT o SIGTERM termina.\n",
+                   ruta_escucha, capacidad_conexiones);
+        }
+        fflush(stdout);
+    }
+
+    // Con ventana > 1 hay varios mensajes en vuelo: mientras el Cliente 3 desencripta
+    // el mensaje N, el Cliente 2 invierte N+1 y el Cliente 1 encripta N+2. Los canales
+    // conservan el orden, así que el resultado k siempre corresponde al envío k.
+    // Con réplicas, el mensaje k va a la réplica k % N1 del Cliente 1 y vuelve por
+    // el canal de la réplica k % N3 del Cliente 3, así que se recibe en orden.
+    //
+    // Además de la ventana se limitan los bytes en vuelo a lo que un solo canal
+    // retiene: así, aunque el Cliente 2 acumule mensajes enteros para invertirlos,
+    // ninguna escritura puede quedar bloqueada para siempre esperando a otra. Un
+    // mensaje más grande que eso sólo se envía cuando no hay otros en vuelo.
+    //
+    // Esos dos límites son los créditos del servidor: un mensaje entra al pipeline
+    // sólo si hay crédito para él, así ninguna write sobre fifo_message espera a
+    // una etapa lenta. Lo que llega sin crédito espera en la cola de admisión,
+    // acotada, y lo que no cabe ahí lo resuelve la política de sobrecarga.
+    size_t capacidad = canal_capacidad(&canal_message[0]);
+    if (canal_capacidad(&canal_result[0]) < capacidad) capacidad = canal_capacidad(&canal_result[0]);
+    en_vuelo_t *en_vuelo = calloc(ventana, sizeof(en_vuelo_t));
+    if (en_vuelo == NULL) {
+        perror("Servidor: calloc");
+        exit(EXIT_FAILURE);
+    }
+    cola_t cola = { .capacidad = capacidad_cola };
+    if ((cola.mensajes = calloc(capacidad_cola, sizeof(pendiente_t))) == NULL) {
+        perror("Servidor: calloc");
+        exit(EXIT_FAILURE);
+    }
+    fuente_t fuente = { .archivo = entrada };
+    char *resultado = NULL;
+    size_t tam_resultado = 0, bytes_en_vuelo = 0, bytes_procesados = 0, maximo_bytes_en_vuelo = 0;
+    unsigned long enviados = 0, mensajes = 0, errores = 0, maximo_en_vuelo = 0;
+    uint32_t crc_enviado = CRC32C_INICIAL, crc_recibido = CRC32C_INICIAL;
+    int fallo = 0;
+    histograma_t latencias;
+    histograma_iniciar(&latencias);
+    struct rusage uso_inicial;
+    getrusage(RUSAGE_SELF, &uso_inicial);
+    double cpu_servidor_inicial = segundos_cpu(&uso_inicial);
+    double inicio = tiempo_actual(), primera_llegada = 0.0, ultimo_resultado = 0.0;
+    fuente.inicio = inicio;
+    while (!fallo) {
+        // Se admite antes de cada envío: con la cola de 1 por defecto, así se
+        // lee la entrada de a una línea, como sin cola.
+        for (;;) {
+            if (frontal != NULL) frontal_admitir(&cola);
+            else admitir_llegadas(&fuente, &cola);
+            if (cola.num == 0 || enviados - mensajes >= (unsigned long)ventana) break;
+            pendiente_t *p = cola_primero(&cola);
+            char *linea = p->linea;
+            size_t longitud = p->longitud;
+            size_t bytes = sizeof(cabecera_t) + longitud;
+            if (enviados != mensajes && bytes_en_vuelo + bytes > capacidad) break;
+
+            cabecera.longitud = longitud;
+            cabecera.secuencia = enviados;
+            if (canal_enviar_trama(&canal_message[enviados % num_message], &cabecera, linea) == -1) {
+                bitacora_registrar(BITACORA_ERROR, EVENTO_FALLO, enviados, errno, NULL, 0);
+                perror("Servidor: write fifo_message");
+                fallo = 1;
+                break;
+            }
+            bitacora_registrar(BITACORA_DEPURACION, EVENTO_ENVIADO, enviados, longitud, linea, longitud);
+            // encrypt -> reverse -> decrypt equivale a invertir: se espera la original invertida.
+            // Con CRC se calcula recorriendo la línea al revés y la línea se reutiliza.
+            en_vuelo_t *e = &en_vuelo[enviados % ventana];
+            if (verificacion == VERIFICACION_COPIA) {
+                reverse_buffer(linea, longitud);
+                e->esperado = linea;
+            } else {
+                if (verificacion == VERIFICACION_CRC) {
+                    e->crc = crc32c_invertido(CRC32C_INICIAL, linea, longitud);
+                } else {
+                    crc_enviado = crc32c_invertido(crc_enviado, linea, longitud);
+                }
+                // La fuente reutiliza el búfer para la próxima línea.
+                if (fuente.linea == NULL) {
+                    fuente.linea = linea;
+                    fuente.tam_linea = p->tam_linea;
+                } else {
+                    free(linea);
+                }
+            }
+            e->longitud = longitud;
+            e->llegada = p->llegada;
+            e->sesion = p->sesion;
+            e->id_sesion = p->id_sesion;
+            e->pedido = p->pedido;
+            cola_sacar(&cola);
+            bytes_en_vuelo += bytes;
+            enviados++;
+            if (enviados - mensajes > maximo_en_vuelo) maximo_en_vuelo = enviados - mensajes;
+            if (bytes_en_vuelo > maximo_bytes_en_vuelo) maximo_bytes_en_vuelo = bytes_en_vuelo;
+        }
+        if (fallo) break;
+        canal_t *canal = &canal_result[mensajes % num_result];
+        if (frontal != NULL) {
+            // Con el frontal la corrida termina con SIGINT o SIGTERM, una vez
+            // respondido lo que ya se había admitido.
+            if (frontal->terminando && cola.num == 0 && enviados == mensajes) break;
+            int listo = frontal_esperar(canal, canal_message, num_message);
+            if (listo == -1) {
+                perror("Servidor: frontal");
+                break;
+            }
+            if (!listo || enviados == mensajes) continue;
+        } else {
+            int entrada_vacia = fuente.agotada && fuente.longitud == 0 && cola.num == 0;
+            if (enviados == mensajes) {
+                if (entrada_vacia) break;
+                // Nada en vuelo ni en la cola: sólo queda esperar la próxima llegada.
+                if (ritmo_llegadas > 0 && cola.num == 0) {
+                    double hora = hora_llegada(&fuente, fuente.leidas);
+                    struct timespec plazo = { (time_t)hora, (long)((hora - (time_t)hora) * 1e9) };
+                    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &plazo, NULL);
+                }
+                continue;
+            }
 
-// Banderas para sincronización con señales (Servidor)
-volatile sig_atomic_t client1_finished = 0;
-volatile sig_atomic_t client2_finished = 0;
-volatile sig_atomic_t client3_finished = 0;
+            // Lo que quede en los lotes de fifo_message debe salir antes de dormir
+            // esperando resultados, o el pipeline se quedaría sin trabajo.
+            int vaciado = 0;
+            if (entrada_vacia) {
+                for (int i = 0; i < num_message && vaciado == 0; i++) vaciado = canal_vaciar(&canal_message[i]);
+            } else {
+                vaciado = canal_esperar_entrada(canal, canal_message, num_message);
+            }
+            if (vaciado == -1) {
+                perror("Servidor: write fifo_message");
+                break;
+            }
+        }
+        int r = canal_recibir_cabecera(canal, &cabecera);
+        if (r != 1) {
+            fprintf(stderr, "Servidor: fifo_result cerrada antes de tiempo\n");
+            break;
+        }
+        // Con CRC el resultado se consume por bloques de tamaño fijo sin guardarlo entero.
+        size_t tam_necesario = cabecera.longitud;
+        if (verificacion != VERIFICACION_COPIA && tam_necesario > BLOQUE_ETAPA) tam_necesario = BLOQUE_ETAPA;
+        if (tam_necesario > tam_resultado) {
+            free(resultado);
+            tam_resultado = tam_necesario;
+            if ((resultado = malloc(tam_resultado)) == NULL) {
+                perror("Servidor: malloc");
+                exit(EXIT_FAILURE);
+            }
+        }
+        uint32_t crc = verificacion == VERIFICACION_FLUJO ? crc_recibido : CRC32C_INICIAL;
+        size_t recibidos = 0;
+        while (recibidos < cabecera.longitud) {
+            size_t n = cabecera.longitud - recibidos < tam_resultado ? cabecera.longitud - recibidos : tam_resultado;
+            if (canal_leer_completo(canal, resultado, n) != (ssize_t)n) break;
+            if (recibidos == 0) {
+                bitacora_registrar(BITACORA_DEPURACION, EVENTO_RECIBIDO, cabecera.secuencia, cabecera.longitud,
+                                   resultado, n);
+            }
+            if (verificacion != VERIFICACION_COPIA) crc = crc32c(crc, resultado, n);
+            recibidos += n;
+        }
+        if (recibidos != cabecera.longitud) {
+            fprintf(stderr, "Servidor: mensaje truncado en fifo_result\n");
+            break;
+        }
+        if (verificacion == VERIFICACION_FLUJO) crc_recibido = crc;
+
+        en_vuelo_t *e = &en_vuelo[mensajes % ventana];
+        double ahora = tiempo_actual();
+        histograma_registrar(&latencias, (uint64_t)((ahora - e->llegada) * 1e9));
+        if (mensajes == 0) {
+            primer_resultado = ahora - lanzamiento;
+            primera_llegada = e->llegada;
+        }
+        ultimo_resultado = ahora;
+        mensajes++;
+        estadistica_fijar(&ranura->mensajes, mensajes);
+        estadistica_sumar(&ranura->bytes, e->longitud);
+        if (mensajes % PERIODO_PROFUNDIDAD == 0) estadistica_profundidad(ranura, canal_profundidad(canal));
+        int coincide = verificacion == VERIFICACION_COPIA ? memcmp(e->esperado, resultado, e->longitud) == 0
+                     : verificacion == VERIFICACION_CRC ? crc == e->crc : 1;
+        if (cabecera.secuencia != mensajes - 1 || cabecera.longitud != e->longitud || !coincide) {
+            errores++;
+            bitacora_registrar(BITACORA_ERROR, EVENTO_DISCREPANCIA, mensajes - 1, cabecera.longitud, NULL, 0);
+            fprintf(stderr, "Servidor: Mensaje %lu NO coincide (%zu bytes enviados, %llu recibidos)\n",
+                    mensajes, e->longitud, (unsigned long long)cabecera.longitud);
+        }
+        if (e->sesion >= 0) frontal_responder(e, resultado);
+        bytes_procesados += e->longitud;
+        bytes_en_vuelo -= sizeof(cabecera_t) + e->longitud;
+        free(e->esperado);
+        e->esperado = NULL;
+    }
+    double segundos = tiempo_actual() - inicio, duracion = segundos;
+    // El frontal pasa tiempo esperando productores: el ritmo se mide desde la
+    // primera llegada hasta el último resultado, los porcentajes de las etapas
+    // sobre toda la corrida.
+    if (frontal != NULL) segundos = mensajes > 0 ? ultimo_resultado - primera_llegada : 0.0;
+    if (verificacion == VERIFICACION_FLUJO && enviados == mensajes && crc_enviado != crc_recibido) {
+        errores++;
+        fprintf(stderr, "Servidor: el CRC32C del flujo NO coincide (esperado %08x, recibido %08x)\n",
+                crc_enviado, crc_recibido);
+    }
+    for (int i = 0; i < ventana; i++) free(en_vuelo[i].esperado);
+    free(en_vuelo);
+    for (; cola.num > 0; cola_sacar(&cola)) free(cola_primero(&cola)->linea);
+    free(cola.mensajes);
+    free(fuente.linea);
+    unsigned long conexiones = 0, huerfanos = 0;
+    int conexiones_maximas = 0;
+    if (frontal != NULL) {
+        conexiones = frontal->aceptadas;
+        conexiones_maximas = frontal->maximo_activas;
+        huerfanos = frontal->huerfanos;
+        frontal_cerrar();
+    }
 
-// Manejador de señales para el SERVIDOR
-void server_signal_handler(int signo) {
-    if (signo == SIGUSR1) {
-        if (waitpid(client1_pid, NULL, WNOHANG) == client1_pid) {
-            client1_finished = 1;
-        } else if (waitpid(client2_pid, NULL, WNOHANG) == client2_pid) {
-            client2_finished = 1;
-        } else if (waitpid(client3_pid, NULL, WNOHANG) == client3_pid) {
-            client3_finished = 1;
+    // Cerrar fifo_message provoca el fin de flujo en cascada a través de las tres
+    // etapas. Si quedaron mensajes en vuelo por un error, las réplicas podrían
+    // estar bloqueadas unas en otras: se terminan en vez de esperar su cierre.
+    for (int i = 0; i < num_message; i++) canal_cerrar(&canal_message[i], 1);
+    if (enviados != mensajes) {
+        if (arranque == ARRANQUE_RESERVA) {
+            reserva_cerrar(1); // La siguiente corrida arma una reserva nueva
+            barrera = NULL;
+        } else {
+            for (int i = 0; i < num_pids; i++) kill(pids[i], SIGTERM);
+        }
+    } else {
+        for (int i = 0; i < num_result; i++) {
+            while (canal_leer(&canal_result[i], (char *)&cabecera, sizeof(cabecera)) > 0)
+                ;
+        }
+    }
+    free(resultado);
+    for (int i = 0; i < num_result; i++) canal_cerrar(&canal_result[i], 0);
+    es_terminar();
+    bitacora_registrar(BITACORA_INFO, EVENTO_FIN, mensajes, (uint32_t)errores, NULL, 0);
+    bitacora_terminar();
+    struct rusage uso_cpu;
+    double cpu_clientes[NUM_ETAPAS] = { 0 };
+    if (arranque == ARRANQUE_RESERVA) {
+        // Los trabajadores no salen: avisan al terminar y dejan su CPU en el puesto.
+        uint32_t visto;
+        while (reserva != NULL && (visto = evento_valor(&reserva->terminados)) - terminados_inicial <
+                                      (uint32_t)num_pids) {
+            evento_esperar(&reserva->terminados, visto);
         }
+        for (int i = 0; reserva != NULL && i < num_pids; i++) cpu_clientes[etapa_pid[i]] += reserva->puestos[i].cpu;
+    } else {
+        for (int i = 0; i < num_pids; i++) {
+            if (wait4(pids[i], NULL, 0, &uso_cpu) == pids[i]) cpu_clientes[etapa_pid[i]] += segundos_cpu(&uso_cpu);
+        }
+    }
+    destruir_transporte(tipo);
+    if (arranque != ARRANQUE_RESERVA) {
+        evento_destruir(barrera);
+        munmap(barrera, sizeof(evento_t));
     }
+    barrera = NULL;
+
+    getrusage(RUSAGE_SELF, &uso_cpu);
+    ranura_t etapas[1 + NUM_ETAPAS * MAX_REPLICAS];
+    memcpy(etapas, estadisticas->ranuras, procesos_flujo * sizeof(ranura_t));
+    destruir_estadisticas();
+    resultado_t res = {
+        .transporte = tipo,
+        .mensajes = mensajes,
+        .errores = errores + (enviados - mensajes),
+        .bytes = bytes_procesados,
+        .segundos = segundos,
+        .duracion = duracion,
+        .hilos = 1,
+        .arranque = listo,
+        .primer_resultado = primer_resultado,
+        .latencias = &latencias,
+        .etapas = etapas,
+        .num_etapas = procesos_flujo,
+        .llegados = cola.llegados,
+        .descartados = cola.descartados,
+        .rechazados = cola.rechazados,
+        .cola_maxima = cola.maximo,
+        .cola_media = cola.llegados ? cola.suma_ocupacion / cola.llegados : 0.0,
+        .en_vuelo_maximo = maximo_en_vuelo,
+        .bytes_en_vuelo_maximo = maximo_bytes_en_vuelo,
+        .conexiones = conexiones,
+        .conexiones_maximas = conexiones_maximas,
+        .huerfanos = huerfanos,
+    };
+    for (uint32_t i = 0; i < procesos_flujo; i++) res.llamadas += estadistica_leer(&etapas[i].llamadas);
+    res.cpu[0] = segundos_cpu(&uso_cpu) - cpu_servidor_inicial;
+    for (int i = 0; i < 3; i++) res.cpu[i + 1] = cpu_clientes[i];
+
+    reportar_resultado(&res);
+    if (mensajes_s != NULL) *mensajes_s = segundos > 0 ? mensajes / segundos : 0.0;
+    return res.errores == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-// Manejador de señales para los CLIENTES
-volatile sig_atomic_t start_task = 0;
-void client_signal_handler(int signo) {
-    if (signo == SIGUSR1) {
-        start_task = 1;
+// ---------------------------------------------------------------------------
+// Pipeline fusionado: la referencia "sin IPC". Toda la entrada se carga en
+// memoria y cada mensaje pasa por fusion_aplicar() (fusion.h) en una sola
+// pasada. Con varios hilos la entrada se reparte en tramos contiguos de
+// líneas completas, uno por hilo, sin nada compartido salvo la entrada.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char *inicio, *fin;    // Líneas completas que procesa el hilo
+    unsigned long mensajes, errores;
+    uint32_t crc_esperado, crc_resultado;   // Con --verificacion flujo
+    size_t bytes;
+    histograma_t latencias;
+} trabajo_fusion_t;
+
+void *hilo_fusion(void *arg) {
+    trabajo_fusion_t *t = arg;
+    char *resultado = NULL, *esperado = NULL;
+    size_t capacidad = 0;
+    for (const char *linea = t->inicio; linea < t->fin;) {
+        const char *salto = memchr(linea, '\n', t->fin - linea);
+        size_t longitud = (salto ? salto : t->fin) - linea;
+        const char *siguiente = salto ? salto + 1 : t->fin;
+        if (longitud == 0) { // Como en modo flujo, las líneas vacías no son mensajes
+            linea = siguiente;
+            continue;
+        }
+        if (longitud > capacidad) {
+            free(resultado);
+            free(esperado);
+            capacidad = longitud;
+            resultado = malloc(capacidad);
+            esperado = verificacion == VERIFICACION_COPIA ? malloc(capacidad) : NULL;
+            if (resultado == NULL || (esperado == NULL && verificacion == VERIFICACION_COPIA)) {
+                perror("Servidor: malloc");
+                exit(EXIT_FAILURE);
+            }
+        }
+        double t0 = tiempo_actual();
+        fusion_aplicar(linea, resultado, longitud);
+        histograma_registrar(&t->latencias, (uint64_t)((tiempo_actual() - t0) * 1e9));
+
+        // Misma verificación que en modo flujo: el resultado es la original invertida.
+        if (verificacion == VERIFICACION_COPIA) {
+            memcpy(esperado, linea, longitud);
+            reverse_buffer(esperado, longitud);
+            if (memcmp(esperado, resultado, longitud) != 0) t->errores++;
+        } else if (verificacion == VERIFICACION_CRC) {
+            if (crc32c_invertido(CRC32C_INICIAL, linea, longitud) !=
+                crc32c(CRC32C_INICIAL, resultado, longitud)) t->errores++;
+        } else {
+            t->crc_esperado = crc32c_invertido(t->crc_esperado, linea, longitud);
+            t->crc_resultado = crc32c(t->crc_resultado, resultado, longitud);
+        }
+        t->mensajes++;
+        t->bytes += longitud;
+        linea = siguiente;
     }
+    free(resultado);
+    free(esperado);
+    return NULL;
 }
 
+int modo_fusionado(FILE *entrada, double *mensajes_s) {
+    // Cargar toda la entrada (archivo o tubería) antes de medir.
+    size_t tam = 0, capacidad = 1 << 20;
+    char *datos = malloc(capacidad);
+    size_t r;
+    while (datos != NULL && (r = fread(datos + tam, 1, capacidad - tam, entrada)) > 0) {
+        tam += r;
+        if (tam == capacidad) datos = realloc(datos, capacidad *= 2);
+    }
+    if (datos == NULL) {
+        perror("Servidor: malloc entrada");
+        exit(EXIT_FAILURE);
+    }
 
-// Función para encriptar una cadena
-void encrypt_string(char *str) {
-    for (int i = 0; str[i] != '\0'; i++) {
-        str[i] += 3; // Suma 3 al valor ASCII
+    int n = hilos > 0 ? hilos : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    trabajo_fusion_t *trabajos = calloc(n, sizeof(trabajo_fusion_t));
+    pthread_t *ids = calloc(n, sizeof(pthread_t));
+    if (trabajos == NULL || ids == NULL) {
+        perror("Servidor: calloc");
+        exit(EXIT_FAILURE);
+    }
+    // Cortes en bytes parejos, corridos hasta el siguiente fin de línea.
+    const char *corte = datos, *fin = datos + tam;
+    for (int i = 0; i < n; i++) {
+        trabajos[i].inicio = corte;
+        const char *objetivo = datos + tam * (i + 1) / n;
+        if (objetivo < corte) objetivo = corte;
+        const char *salto = i == n - 1 ? NULL : memchr(objetivo, '\n', fin - objetivo);
+        corte = salto ? salto + 1 : fin;
+        trabajos[i].fin = corte;
+        trabajos[i].crc_esperado = trabajos[i].crc_resultado = CRC32C_INICIAL;
+        histograma_iniciar(&trabajos[i].latencias);
+    }
+    if (formato == FORMATO_TEXTO) {
+        printf("Servidor (PID: %d): Pipeline fusionado (sin IPC) con %d hilos sobre %zu bytes.\n",
+               getpid(), n, tam);
+    }
+
+    struct rusage uso_cpu;
+    getrusage(RUSAGE_SELF, &uso_cpu);
+    double cpu_inicial = segundos_cpu(&uso_cpu);
+    double inicio = tiempo_actual();
+    for (int i = 1; i < n; i++) {
+        if ((errno = pthread_create(&ids[i], NULL, hilo_fusion, &trabajos[i])) != 0) {
+            perror("Servidor: pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    hilo_fusion(&trabajos[0]);
+    for (int i = 1; i < n; i++) pthread_join(ids[i], NULL);
+    double segundos = tiempo_actual() - inicio;
+    getrusage(RUSAGE_SELF, &uso_cpu);
+
+    histograma_t latencias;
+    histograma_iniciar(&latencias);
+    resultado_t res = {
+        .transporte = TRANSPORTE_FUSIONADO,
+        .segundos = segundos,
+        .hilos = n,
+        .latencias = &latencias,
+    };
+    res.cpu[0] = segundos_cpu(&uso_cpu) - cpu_inicial;
+    for (int i = 0; i < n; i++) {
+        res.mensajes += trabajos[i].mensajes;
+        res.errores += trabajos[i].errores + (trabajos[i].crc_esperado != trabajos[i].crc_resultado);
+        res.bytes += trabajos[i].bytes;
+        histograma_sumar(&latencias, &trabajos[i].latencias);
     }
+    free(trabajos);
+    free(ids);
+    free(datos);
+
+    reportar_resultado(&res);
+    if (mensajes_s != NULL) *mensajes_s = segundos > 0 ? res.mensajes / segundos : 0.0;
+    return res.errores == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-// Función para desencriptar una cadena
-void decrypt_string(char *str) {
-    for (int i = 0; str[i] != '\0'; i++) {
-        str[i] -= 3; 
+// ---------------------------------------------------------------------------
+// Modo archivo mapeado: el archivo completo es un solo mensaje. Se mapea la
+// entrada y un archivo de salida del mismo tamaño, y varios procesos
+// trabajadores se reparten trozos de la entrada. Como el resultado es la
+// entrada invertida, el trozo [a, b) se escribe transformado en la posición
+// espejo [tam - b, tam - a) de la salida: cada trozo es independiente y la
+// inversión global sale bien sin coordinar los bordes. Nada pasa por un búfer
+// intermedio: cada sub-bloque se copia una vez de un mapeo al otro y las tres
+// etapas lo transforman ahí mientras sigue en caché.
+// ---------------------------------------------------------------------------
+
+#define TROZO_MAPEADO (4 * 1024 * 1024)   // Unidad de reparto entre trabajadores
+#define BLOQUE_MAPEADO BLOQUE_ETAPA        // Lo que las tres etapas tocan seguido
+
+void procesar_trozo(const char *entrada, char *salida, size_t tam, size_t inicio, size_t n) {
+    for (size_t o = 0; o < n; o += BLOQUE_MAPEADO) {
+        size_t b = n - o < BLOQUE_MAPEADO ? n - o : BLOQUE_MAPEADO;
+        char *destino = salida + tam - inicio - o - b;
+        memcpy(destino, entrada + inicio + o, b);
+        encrypt_buffer(destino, b);
+        reverse_buffer(destino, b);
+        decrypt_buffer(destino, b);
     }
 }
 
-// Función para invertir una cadena
-void reverse_string(char *str) {
-    int length = strlen(str);
-    for (int i = 0; i < length / 2; i++) {
-        char temp = str[i];
-        str[i] = str[length - 1 - i];
-        str[length - 1 - i] = temp;
+int modo_mapeado(const char *ruta_entrada, const char *ruta_salida, int trabajadores) {
+    int fd_entrada = open(ruta_entrada, O_RDONLY);
+    struct stat st;
+    if (fd_entrada == -1 || fstat(fd_entrada, &st) == -1) {
+        perror(ruta_entrada);
+        return EXIT_FAILURE;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        fprintf(stderr, "%s: el modo mapeado requiere un archivo regular\n", ruta_entrada);
+        return EXIT_FAILURE;
+    }
+    size_t tam = st.st_size;
+    int fd_salida = open(ruta_salida, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_salida == -1 || ftruncate(fd_salida, tam) == -1) {
+        perror(ruta_salida);
+        return EXIT_FAILURE;
+    }
+    if (trabajadores <= 0) trabajadores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (trabajadores < 1) trabajadores = 1;
+
+    // La medición incluye el mapeo. MAP_POPULATE resuelve todas las páginas de una
+    // vez en lugar de un fallo de página por cada 4 KiB dentro de los trabajadores.
+    double inicio = tiempo_actual();
+    char *entrada = NULL, *salida = NULL;
+    if (tam > 0) {
+        entrada = mmap(NULL, tam, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd_entrada, 0);
+        salida = mmap(NULL, tam, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_salida, 0);
+        if (entrada == MAP_FAILED || salida == MAP_FAILED) {
+            perror("Servidor: mmap archivo");
+            return EXIT_FAILURE;
+        }
+        madvise(entrada, tam, MADV_SEQUENTIAL);
+    }
+    close(fd_entrada);
+    close(fd_salida);
+
+    // Próximo trozo sin asignar: cada trabajador toma el siguiente al terminar
+    // el suyo, así uno lento (o un núcleo ocupado) no retrasa a los demás.
+    _Atomic uint64_t *siguiente = mmap(NULL, sizeof(*siguiente), PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (siguiente == MAP_FAILED) {
+        perror("Servidor: mmap reparto");
+        return EXIT_FAILURE;
+    }
+    atomic_store(siguiente, 0);
+    size_t trozos = (tam + TROZO_MAPEADO - 1) / TROZO_MAPEADO;
+    if (formato == FORMATO_TEXTO) {
+        printf("Servidor (PID: %d): Archivo mapeado %s (%zu bytes) -> %s, %d trabajadores, %zu trozos.\n",
+               getpid(), ruta_entrada, tam, ruta_salida, trabajadores, trozos);
+    }
+
+    fflush(stdout);
+    pid_t *pids = calloc(trabajadores, sizeof(pid_t));
+    if (pids == NULL) {
+        perror("Servidor: calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < trabajadores; i++) {
+        if ((pids[i] = fork()) < 0) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pids[i] == 0) {
+            uint64_t k;
+            while ((k = atomic_fetch_add(siguiente, 1)) < trozos) {
+                size_t a = k * TROZO_MAPEADO;
+                procesar_trozo(entrada, salida, tam, a, tam - a < TROZO_MAPEADO ? tam - a : TROZO_MAPEADO);
+            }
+            exit(EXIT_SUCCESS);
+        }
     }
+    double cpu_trabajadores = 0.0;
+    int fallos = 0, estado;
+    struct rusage uso_cpu;
+    for (int i = 0; i < trabajadores; i++) {
+        if (wait4(pids[i], &estado, 0, &uso_cpu) == pids[i]) cpu_trabajadores += segundos_cpu(&uso_cpu);
+        if (!WIFEXITED(estado) || WEXITSTATUS(estado) != 0) fallos++;
+    }
+    double segundos = tiempo_actual() - inicio;
+    free(pids);
+    munmap(siguiente, sizeof(*siguiente));
+
+    // Verificación fuera de la medición: la salida debe ser la entrada invertida.
+    // Con CRC (crc o flujo, que aquí coinciden: hay un solo mensaje) se comparan
+    // el CRC32C de la entrada recorrida al revés y el de la salida, sin copiar nada.
+    unsigned long errores = fallos;
+    if (verificacion != VERIFICACION_COPIA) {
+        if (tam > 0 && crc32c_invertido(CRC32C_INICIAL, entrada, tam) != crc32c(CRC32C_INICIAL, salida, tam))
+            errores++;
+    } else {
+        char *bloque = malloc(BLOQUE_MAPEADO);
+        if (bloque == NULL) {
+            perror("Servidor: malloc");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t o = 0; o < tam; o += BLOQUE_MAPEADO) {
+            size_t b = tam - o < BLOQUE_MAPEADO ? tam - o : BLOQUE_MAPEADO;
+            memcpy(bloque, entrada + o, b);
+            reverse_buffer(bloque, b);
+            if (memcmp(bloque, salida + tam - o - b, b) != 0) errores++;
+        }
+        free(bloque);
+    }
+    if (tam > 0) {
+        munmap(entrada, tam);
+        munmap(salida, tam);
+    }
+
+    double mbs = segundos > 0 ? tam / segundos / 1e6 : 0.0;
+    switch (formato) {
+        case FORMATO_CSV:
+            printf("modo,trabajadores,bytes,trozos,segundos,mb_s,verificacion,errores,cpu_trabajadores_s\n");
+            printf("mapeado,%d,%zu,%zu,%.6f,%.1f,%s,%lu,%.4f\n", trabajadores, tam, trozos, segundos, mbs,
+                   nombre_verificacion(verificacion), errores, cpu_trabajadores);
+            break;
+        case FORMATO_JSON:
+            printf("{\"modo\":\"mapeado\",\"trabajadores\":%d,\"bytes\":%zu,\"trozos\":%zu,"
+                   "\"segundos\":%.6f,\"mb_s\":%.1f,\"verificacion\":\"%s\",\"errores\":%lu,"
+                   "\"cpu_trabajadores_s\":%.4f}\n",
+                   trabajadores, tam, trozos, segundos, mbs, nombre_verificacion(verificacion), errores,
+                   cpu_trabajadores);
+            break;
+        default:
+            printf("Servidor [mapeado, %d trabajadores]: %zu bytes en %.3f s, %.1f MB/s; %s\n", trabajadores,
+                   tam, segundos, mbs, errores == 0 ? "la salida coincide" : "la salida NO coincide");
+            printf("Servidor [mapeado, %d trabajadores]: CPU s trabajadores %.3f\n", trabajadores,
+                   cpu_trabajadores);
+            break;
+    }
+    return errores == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ---------------------------------------------------------------------------
+// Latencia de despertar: un ping-pong entre el servidor y un hijo. Cada vuelta
+// son dos despertares, así que la latencia de uno es la mitad de la vuelta.
+// Se compara SIGUSR1 (como el protocolo original) con cada modo de evento.
+// ---------------------------------------------------------------------------
+
+int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Devuelve las vueltas medidas en microsegundos; 'modo' < 0 indica SIGUSR1.
+void ping_pong(int modo, int iteraciones, double *vueltas) {
+    evento_t *eventos = mmap(NULL, 2 * sizeof(evento_t), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (eventos == MAP_FAILED) {
+        perror("mmap eventos");
+        exit(EXIT_FAILURE);
+    }
+    evento_t *ping = &eventos[0], *pong = &eventos[1];
+    sigset_t usr1;
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+    if (modo < 0) {
+        sigprocmask(SIG_BLOCK, &usr1, NULL); // Se recibe con sigwaitinfo, sin manejador
+    } else if (evento_iniciar(ping, modo, giros_notificacion) == -1 ||
+               evento_iniciar(pong, modo, giros_notificacion) == -1) {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
+
+    fflush(stdout);
+    pid_t hijo = fork();
+    if (hijo < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (hijo == 0) {
+        for (int k = 0; k < iteraciones; k++) {
+            if (modo < 0) {
+                sigwaitinfo(&usr1, NULL);
+                kill(getppid(), SIGUSR1);
+            } else {
+                esperar_notificacion(ping, k);
+                evento_notificar(pong);
+            }
+        }
+        exit(EXIT_SUCCESS);
+    }
+
+    for (int k = 0; k < iteraciones; k++) {
+        double t0 = tiempo_actual();
+        if (modo < 0) {
+            kill(hijo, SIGUSR1);
+            sigwaitinfo(&usr1, NULL);
+        } else {
+            evento_notificar(ping);
+            esperar_notificacion(pong, k);
+        }
+        vueltas[k] = (tiempo_actual() - t0) * 1e6;
+    }
+    waitpid(hijo, NULL, 0);
+
+    if (modo < 0) {
+        sigprocmask(SIG_UNBLOCK, &usr1, NULL);
+    } else {
+        evento_destruir(ping);
+        evento_destruir(pong);
+    }
+    munmap(eventos, 2 * sizeof(evento_t));
+}
+
+int medir_latencia_despertar(int iteraciones) {
+    double *vueltas = malloc(iteraciones * sizeof(double));
+    if (vueltas == NULL) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    const char *nombres[] = { "senal", "futex", "eventfd", "giro" };
+    const int modos[] = { -1, NOTIFICACION_FUTEX, NOTIFICACION_EVENTFD, NOTIFICACION_GIRO };
+
+    printf("Latencia de despertar (us, mitad de una vuelta), %d vueltas, giros=%d\n",
+           iteraciones, giros_notificacion);
+    printf("%-10s %10s %10s %10s %10s\n", "modo", "media", "p50", "p99", "max");
+    for (int m = 0; m < 4; m++) {
+        ping_pong(modos[m], iteraciones, vueltas);
+        double suma = 0;
+        for (int k = 0; k < iteraciones; k++) suma += vueltas[k];
+        qsort(vueltas, iteraciones, sizeof(double), comparar_double);
+        printf("%-10s %10.2f %10.2f %10.2f %10.2f\n", nombres[m],
+               suma / iteraciones / 2, vueltas[iteraciones / 2] / 2,
+               vueltas[(int)(iteraciones * 0.99)] / 2, vueltas[iteraciones - 1] / 2);
+    }
+    free(vueltas);
+    return EXIT_SUCCESS;
+}
+
+// ---------------------------------------------------------------------------
+// Autoprueba de los núcleos de transformaciones.h: cada implementación que la
+// CPU soporta se compara con encrypt_string/reverse_string/decrypt_string para
+// todas las longitudes hasta 1024 y las 64 alineaciones posibles de una línea
+// de caché; después se mide su ancho de banda sobre un búfer grande.
+// ---------------------------------------------------------------------------
+
+#define AUTOPRUEBA_MAX_LONGITUD 1024
+#define AUTOPRUEBA_ALINEACIONES 64
+#define AUTOPRUEBA_BUFFER (64 * 1024 * 1024)
+
+// CRC32C: el vector de prueba estándar, y la versión seleccionada contra la de
+// tabla en todas las longitudes y alineaciones, hacia adelante y al revés (el
+// CRC invertido de un búfer debe ser el CRC de su copia invertida).
+int autoprueba_crc32c(void) {
+    static char entrada[AUTOPRUEBA_MAX_LONGITUD + AUTOPRUEBA_ALINEACIONES];
+    static char invertida[AUTOPRUEBA_MAX_LONGITUD];
+    int fallos = 0;
+    if (~crc32c(CRC32C_INICIAL, "123456789", 9) != 0xE3069283u) {
+        printf("crc32c   FALLA el vector de prueba \"123456789\"\n");
+        fallos++;
+    }
+    for (size_t i = 0; i < sizeof(entrada); i++) entrada[i] = rand();
+    for (size_t len = 0; len <= AUTOPRUEBA_MAX_LONGITUD; len++) {
+        for (size_t alin = 0; alin < AUTOPRUEBA_ALINEACIONES; alin++) {
+            const char *p = entrada + alin;
+            memcpy(invertida, p, len);
+            reverse_buffer(invertida, len);
+            uint32_t referencia = crc32c_software(CRC32C_INICIAL, p, len);
+            if (crc32c(CRC32C_INICIAL, p, len) != referencia ||
+                crc32c_invertido(CRC32C_INICIAL, invertida, len) != referencia ||
+                crc32c_software_invertido(CRC32C_INICIAL, invertida, len) != referencia) {
+                if (fallos++ == 0) printf("crc32c   FALLA con longitud %zu y alineación %zu\n", len, alin);
+            }
+        }
+    }
+
+    char *grande = calloc(1, AUTOPRUEBA_BUFFER);
+    if (grande == NULL) {
+        perror("calloc");
+        return fallos + 1;
+    }
+    printf("crc32c   %s (%s)", fallos == 0 ? "correcto" : "INCORRECTO", crc32c_nombre);
+    crc32c_t funciones[] = { crc32c, crc32c_invertido };
+    const char *nombres[] = { "adelante", "invertido" };
+    volatile uint32_t crc = CRC32C_INICIAL; // Para que el compilador no descarte el cálculo
+    for (int f = 0; f < 2; f++) {
+        double inicio = tiempo_actual();
+        for (int r = 0; r < 8; r++) crc = funciones[f](crc, grande, AUTOPRUEBA_BUFFER);
+        double segundos = tiempo_actual() - inicio;
+        printf("  %s %.2f GB/s", nombres[f], 8.0 * AUTOPRUEBA_BUFFER / segundos / 1e9);
+    }
+    printf("\n");
+    free(grande);
+    return fallos;
+}
+
+// Percentiles del histograma con una distribución conocida: todas las muestras
+// en 1 us salvo un valor atípico de 1 ms. El rango se redondea hacia arriba, así
+// que el atípico aparece en cuanto p * n deja de ser entero por debajo de n.
+int autoprueba_histograma(void) {
+    static const struct {
+        int muestras;
+        double p;
+        int atipico;            // 1 si el percentil debe ser el valor atípico
+    } casos[] = {
+        { 100, 0.50, 0 }, { 100, 0.99, 0 }, { 100, 0.999, 1 },
+        { 120, 0.99, 0 }, { 120, 0.999, 1 }, { 1000, 0.999, 0 }, { 1000, 1.0, 1 },
+    };
+    int fallos = 0;
+    for (size_t c = 0; c < sizeof(casos) / sizeof(casos[0]); c++) {
+        histograma_t h;
+        histograma_iniciar(&h);
+        for (int i = 1; i < casos[c].muestras; i++) histograma_registrar(&h, 1000);
+        histograma_registrar(&h, 1000000);
+        uint64_t valor = histograma_percentil(&h, casos[c].p);
+        int correcto = casos[c].atipico ? valor == 1000000 : valor >= 1000 && valor < 1000000 / 2;
+        if (!correcto) {
+            printf("histograma FALLA p%g con %d muestras: %lu ns\n", casos[c].p * 100, casos[c].muestras,
+                   (unsigned long)valor);
+            fallos++;
+        }
+    }
+    printf("histograma %s\n", fallos == 0 ? "correcto" : "INCORRECTO");
+    return fallos;
+}
+
+int autoprueba_kernels(void) {
+    static char entrada[AUTOPRUEBA_MAX_LONGITUD + 1];
+    static char referencia[AUTOPRUEBA_MAX_LONGITUD + 1];
+    static char prueba[AUTOPRUEBA_MAX_LONGITUD + AUTOPRUEBA_ALINEACIONES + 1];
+    void (*escalares[])(char *) = { encrypt_string, reverse_string, decrypt_string };
+    const char *nombres[] = { "cifrar", "invertir", "descifrar" };
+    int fallos = 0;
+
+    seleccionar_kernels();
+    srand(1);
+    for (size_t k = 0; k < NUM_IMPLEMENTACIONES; k++) {
+        const implementacion_t *impl = &implementaciones[k];
+        if (!implementacion_soportada(impl)) {
+            printf("%-8s no soportada por esta CPU\n", impl->nombre);
+            continue;
+        }
+        kernel_t nucleos[] = { impl->cifrar, impl->invertir, impl->descifrar };
+        int fallos_impl = 0;
+        for (int t = 0; t < 3; t++) {
+            for (size_t len = 0; len <= AUTOPRUEBA_MAX_LONGITUD; len++) {
+                // Las funciones de referencia se detienen en '\0', así que se evita ese byte.
+                for (size_t i = 0; i < len; i++) entrada[i] = 1 + rand() % 255;
+                entrada[len] = '\0';
+                memcpy(referencia, entrada, len + 1);
+                escalares[t](referencia);
+                for (size_t alin = 0; alin < AUTOPRUEBA_ALINEACIONES; alin++) {
+                    memcpy(prueba + alin, entrada, len + 1);
+                    nucleos[t](prueba + alin, len);
+                    if (memcmp(prueba + alin, referencia, len + 1) != 0) {
+                        if (fallos_impl++ == 0) {
+                            printf("%-8s FALLA %s con longitud %zu y alineación %zu\n",
+                                   impl->nombre, nombres[t], len, alin);
+                        }
+                    }
+                }
+            }
+        }
+        fallos += fallos_impl;
+
+        char *grande = malloc(AUTOPRUEBA_BUFFER);
+        if (grande == NULL) {
+            perror("malloc");
+            return EXIT_FAILURE;
+        }
+        memset(grande, 'a', AUTOPRUEBA_BUFFER);
+        printf("%-8s %s", impl->nombre, fallos_impl == 0 ? "correcta" : "INCORRECTA");
+        for (int t = 0; t < 3; t++) {
+            double inicio = tiempo_actual();
+            for (int r = 0; r < 8; r++) nucleos[t](grande, AUTOPRUEBA_BUFFER);
+            double segundos = tiempo_actual() - inicio;
+            printf("  %s %.2f GB/s", nombres[t], 8.0 * AUTOPRUEBA_BUFFER / segundos / 1e9);
+        }
+        printf("\n");
+        free(grande);
+    }
+    printf("Implementación seleccionada: %s\n", kernels->nombre);
+    fallos += autoprueba_crc32c();
+    fallos += autoprueba_histograma();
+    return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void uso(const char *programa) {
+    fprintf(stderr, "Uso: %s [-f|--flujo] [-t|--transporte fifo|shm|fusionado|ambos|todos]\n"
+                    "          [-n|--notificacion futex|eventfd|giro] [--giros N]\n"
+                    "          [-p[N]|--pipeline[=N]] [-b|--lote N[,N...]] [--espera-lote USEC]\n"
+                    "          [-r|--replicas N|N1xN2xN3[,...]] [--hilos N] [--verificacion copia|crc|flujo]\n"
+                    "          [--arranque fork|spawn|reserva[,...]] [--es bloqueante|uring]\n"
+                    "          [--cola N] [--cola-bytes B] [--sobrecarga bloquear|descartar-nuevo|descartar-viejo|rechazar]\n"
+                    "          [--llegadas R[xB]] [--escuchar ruta [--conexiones N]]\n"
+                    "          [--bitacora archivo [--nivel-bitacora error|info|depuracion] [--carga-bitacora N]]\n"
+                    "          [--cpus S/C1/C2/C3] [--prioridad-fifo P] [--paginas-enormes]\n"
+                    "          [--formato texto|csv|json] [-L|--latencia-despertar [N]] [--autoprueba] [archivo]\n"
+                    "       %s -M|--mapeado [-w|--trabajadores N] [--verificacion ...] [--formato ...] entrada salida\n", programa, programa);
+    fprintf(stderr, "  sin opciones      procesa una sola cadena leída de la entrada estándar\n");
+    fprintf(stderr, "  -f, --flujo       procesa cada línea de 'archivo' (o stdin) con clientes persistentes\n");
+    fprintf(stderr, "  -t, --transporte  canal entre etapas en modo flujo (por defecto fifo);\n");
+    fprintf(stderr, "                    'ambos' repite el mismo archivo con fifo y con shm; 'fusionado'\n");
+    fprintf(stderr, "                    aplica las tres etapas en un solo proceso, sin IPC (referencia);\n");
+    fprintf(stderr, "                    'todos' compara fifo, shm y fusionado\n");
+    fprintf(stderr, "  -M, --mapeado     procesa 'entrada' completa como un solo mensaje con mmap y escribe\n"
+                    "                    el resultado en 'salida' (también mapeada), repartiendo trozos\n");
+    fprintf(stderr, "  -w, --trabajadores N  procesos del modo mapeado (por defecto 0 = uno por núcleo)\n");
+    fprintf(stderr, "      --hilos N     hilos del pipeline fusionado (por defecto 1; 0 = uno por núcleo)\n");
+    fprintf(stderr, "  -p, --pipeline    mantiene hasta N mensajes en vuelo (por defecto 64, máx. %d);\n"
+                    "                    N va pegado a la opción (-p64, --pipeline=64): '-p 64' toma\n"
+                    "                    64 como el archivo\n", VENTANA_MAXIMA);
+    fprintf(stderr, "  -b, --lote        mensajes por escritura en las FIFOs (por defecto 1); con una\n");
+    fprintf(stderr, "                    lista se repite el archivo con cada tamaño de lote; úsese con -p\n");
+    fprintf(stderr, "      --espera-lote máximo que espera un mensaje a completar su lote (por defecto 200 us)\n");
+    fprintf(stderr, "  -r, --replicas    procesos por etapa: N o N1xN2xN3 (máx. %d cada una); con una\n"
+                    "                    lista se repite el archivo y se imprime una tabla de escalado;\n"
+                    "                    la ventana (-p) debe alcanzar para ocupar a todas las réplicas\n",
+            MAX_REPLICAS);
+    fprintf(stderr, "      --verificacion  cómo se comprueba cada resultado: 'copia' guarda los mensajes en\n"
+                    "                    vuelo (por defecto), 'crc' sólo su CRC32C, 'flujo' un CRC de toda\n"
+                    "                    la corrida (memoria constante, pero no dice qué mensaje falló)\n");
+    fprintf(stderr, "      --arranque    cómo se crean las etapas: 'fork' en cada corrida (por defecto),\n"
+                    "                    'spawn' con posix_spawn, 'reserva' procesos creados al inicio que\n"
+                    "                    esperan trabajo; con una lista se comparan midiendo el tiempo\n"
+                    "                    hasta tener las etapas listas y hasta el primer resultado\n");
+    fprintf(stderr, "      --es          E/S de las FIFOs: 'bloqueante' con read/write (por defecto) o\n"
+                    "                    'uring' con io_uring: lecturas adelantadas y escrituras en vuelo\n"
+                    "                    en cada canal, enviadas juntas en una llamada por espera\n");
+    fprintf(stderr, "      --cola N      mensajes que pueden esperar crédito para entrar al pipeline (por\n"
+                    "                    defecto 1); los créditos son la ventana (-p) y los bytes en vuelo\n");
+    fprintf(stderr, "      --cola-bytes B  bytes que puede retener la cola (por defecto 64 MiB)\n");
+    fprintf(stderr, "      --sobrecarga  con la cola llena: 'bloquear' deja de leer la entrada (por defecto),\n"
+                    "                    'descartar-nuevo' tira lo que llega, 'descartar-viejo' lo más antiguo\n"
+                    "                    de la cola, 'rechazar' se lo devuelve a quien lo entregó\n");
+    fprintf(stderr, "      --llegadas R[xB]  la entrada llega a R mensajes/s en ráfagas de B (lazo abierto);\n"
+                    "                    la latencia se mide desde la llegada, con la espera en la cola\n");
+    fprintf(stderr, "      --escuchar    en lugar de 'archivo', atiende productores en el socket Unix 'ruta':\n"
+                    "                    cada línea recibida es un mensaje y su resultado vuelve por la\n"
+                    "                    misma conexión (o '!descartado'/'!rechazado'); corre hasta\n"
+                    "                    SIGINT o SIGTERM. Sólo con -t fifo y --es bloqueante\n");
+    fprintf(stderr, "      --conexiones N  sesiones simultáneas del frontal (por defecto 4096)\n");
+    fprintf(stderr, "      --bitacora    registros binarios de cada proceso en 'archivo' (./bitacora los muestra);\n"
+                    "                    en modo clásico reemplazan los mensajes con las cadenas\n");
+    fprintf(stderr, "      --nivel-bitacora  'error', 'info' (por defecto: inicio y fin de cada proceso) o\n"
+                    "                    'depuracion' (además un registro por mensaje y etapa)\n");
+    fprintf(stderr, "      --carga-bitacora N  bytes de cada mensaje que se copian al registro (por defecto 0:\n"
+                    "                    nunca se vuelca la carga)\n");
+    fprintf(stderr, "      --cpus        CPUs del servidor y de cada cliente, separadas por '/': listas como\n"
+                    "                    '0-3,8', 'nN' (el nodo NUMA N, también para su memoria) o '-' (sin\n"
+                    "                    fijar); con tantas CPUs como réplicas, cada réplica usa una\n");
+    fprintf(stderr, "      --prioridad-fifo P  servidor y etapas bajo SCHED_FIFO con prioridad P (requiere\n"
+                    "                    CAP_SYS_NICE; si no, se sigue con la política normal)\n");
+    fprintf(stderr, "      --paginas-enormes  la región de anillos de -t shm en páginas de 2 MB: hugetlbfs si\n"
+                    "                    hay páginas reservadas, si no THP de shmem (MADV_HUGEPAGE)\n");
+    fprintf(stderr, "      --formato     reporte de cada corrida: texto, una fila csv o un objeto json por línea\n");
+    fprintf(stderr, "  -n, --notificacion  cómo se despiertan las etapas (por defecto futex)\n");
+    fprintf(stderr, "      --giros N     iteraciones de espera activa antes de dormir (por defecto 100)\n");
+    fprintf(stderr, "  -L, --latencia-despertar  mide la latencia de despertar de cada modo (N vueltas)\n");
+    fprintf(stderr, "      --autoprueba  verifica los núcleos SIMD contra las funciones escalares, el CRC32C\n"
+                    "                    y los percentiles del histograma de latencias\n");
+    fprintf(stderr, "En modo flujo cada etapa publica sus contadores en " SHM_ESTADISTICAS ";\n"
+                    "./estadisticas los muestra en vivo.\n");
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     char original_message[BUFFER_SIZE];
     char processed_message[BUFFER_SIZE];
     int fd; 
 
-    // 1. Configurar manejador de señales (Servidor)
-    struct sigaction sa_server;
-    sa_server.sa_handler = server_signal_handler;
-    sigemptyset(&sa_server.sa_mask);
-    sa_server.sa_flags = SA_RESTART | SA_NOCLDWAIT; // SA_NOCLDWAIT evita que el padre tenga que llamar waitpid
-                                                    // SA_RESTART: reinicia las syscalls que la señal pudo interrumpir.
-    if (sigaction(SIGUSR1, &sa_server, NULL) == -1) {
-        perror("Servidor: sigaction");
+    int flujo = 0, latencia = 0, autoprueba = 0, mapeado = 0, trabajadores = 0;
+    int transportes[3] = { TRANSPORTE_FIFO }, num_transportes = 1;
+    int lotes[MAX_LOTES] = { 1 }, num_lotes = 1;
+    enum arranque arranques[MAX_ARRANQUES] = { ARRANQUE_FORK };
+    int num_arranques = 1;
+    const char *etapa_lanzada_con = NULL;
+    int configuraciones[MAX_CONFIGURACIONES][NUM_ETAPAS] = { { 1, 1, 1 } }, num_configuraciones = 1;
+    static struct option opciones[] = {
+        { "flujo",      no_argument,       NULL, 'f' },
+        { "transporte", required_argument, NULL, 't' },
+        { "notificacion", required_argument, NULL, 'n' },
+        { "giros",      required_argument, NULL, 'g' },
+        { "latencia-despertar", optional_argument, NULL, 'L' },
+        { "pipeline",   optional_argument, NULL, 'p' },
+        { "autoprueba", no_argument,       NULL, 'A' },
+        { "lote",       required_argument, NULL, 'b' },
+        { "espera-lote", required_argument, NULL, 'E' },
+        { "formato",    required_argument, NULL, 'F' },
+        { "replicas",   required_argument, NULL, 'r' },
+        { "hilos",      required_argument, NULL, 'H' },
+        { "mapeado",    no_argument,       NULL, 'M' },
+        { "trabajadores", required_argument, NULL, 'w' },
+        { "verificacion", required_argument, NULL, 'V' },
+        { "arranque",   required_argument, NULL, 'a' },
+        { "es",         required_argument, NULL, 'I' },
+        { "bitacora",   required_argument, NULL, 'B' },
+        { "cola",       required_argument, NULL, 'Q' },
+        { "cola-bytes", required_argument, NULL, 'K' },
+        { "sobrecarga", required_argument, NULL, 'O' },
+        { "llegadas",   required_argument, NULL, 'R' },
+        { "escuchar",   required_argument, NULL, 'U' },
+        { "conexiones", required_argument, NULL, 'X' },
+        { "nivel-bitacora", required_argument, NULL, 'N' },
+        { "carga-bitacora", required_argument, NULL, 'C' },
+        { "cpus",       required_argument, NULL, 'Y' },
+        { "prioridad-fifo", required_argument, NULL, 'P' },
+        { "paginas-enormes", no_argument,  NULL, 'G' },
+        { "etapa",      required_argument, NULL, 'e' },   // Interna: etapa lanzada con posix_spawn
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opcion;
+    while ((opcion = getopt_long(argc, argv, "ft:n:L::p::b:r:Mw:h", opciones, NULL)) != -1) {
+        switch (opcion) {
+            case 'f': flujo = 1; break;
+            case 't':
+                if (strcmp(optarg, "fifo") == 0) {
+                    transportes[0] = TRANSPORTE_FIFO;
+                    num_transportes = 1;
+                } else if (strcmp(optarg, "shm") == 0) {
+                    transportes[0] = TRANSPORTE_SHM;
+                    num_transportes = 1;
+                } else if (strcmp(optarg, "fusionado") == 0) {
+                    transportes[0] = TRANSPORTE_FUSIONADO;
+                    num_transportes = 1;
+                } else if (strcmp(optarg, "ambos") == 0 || strcmp(optarg, "todos") == 0) {
+                    transportes[0] = TRANSPORTE_FIFO;
+                    transportes[1] = TRANSPORTE_SHM;
+                    transportes[2] = TRANSPORTE_FUSIONADO;
+                    num_transportes = strcmp(optarg, "todos") == 0 ? 3 : 2;
+                } else {
+                    fprintf(stderr, "Transporte desconocido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'n':
+                if (strcmp(optarg, "futex") == 0) {
+                    modo_notificacion = NOTIFICACION_FUTEX;
+                } else if (strcmp(optarg, "eventfd") == 0) {
+                    modo_notificacion = NOTIFICACION_EVENTFD;
+                } else if (strcmp(optarg, "giro") == 0) {
+                    modo_notificacion = NOTIFICACION_GIRO;
+                } else {
+                    fprintf(stderr, "Notificación desconocida: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                ventana = optarg ? atoi(optarg) : 64;
+                if (ventana < 1 || ventana > VENTANA_MAXIMA) {
+                    fprintf(stderr, "La ventana debe estar entre 1 y %d\n", VENTANA_MAXIMA);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'A': autoprueba = 1; break;
+            case 'b': {
+                num_lotes = 0;
+                for (char *p = strtok(optarg, ","); p != NULL; p = strtok(NULL, ",")) {
+                    if (num_lotes == MAX_LOTES || (lotes[num_lotes++] = atoi(p)) < 1) {
+                        fprintf(stderr, "Lote inválido: hasta %d tamaños mayores que 0\n", MAX_LOTES);
+                        return EXIT_FAILURE;
+                    }
+                }
+                if (num_lotes == 0) {
+                    fprintf(stderr, "Lote inválido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'E': espera_lote_us = atol(optarg); break;
+            case 'a':
+                num_arranques = 0;
+                for (char *p = strtok(optarg, ","); p != NULL; p = strtok(NULL, ",")) {
+                    enum arranque a;
+                    if (strcmp(p, "fork") == 0) {
+                        a = ARRANQUE_FORK;
+                    } else if (strcmp(p, "spawn") == 0) {
+                        a = ARRANQUE_SPAWN;
+                    } else if (strcmp(p, "reserva") == 0) {
+                        a = ARRANQUE_RESERVA;
+                    } else {
+                        fprintf(stderr, "Arranque desconocido: '%s'\n", p);
+                        return EXIT_FAILURE;
+                    }
+                    if (num_arranques == MAX_ARRANQUES) {
+                        fprintf(stderr, "Arranque inválido: hasta %d modos\n", MAX_ARRANQUES);
+                        return EXIT_FAILURE;
+                    }
+                    arranques[num_arranques++] = a;
+                }
+                if (num_arranques == 0) {
+                    fprintf(stderr, "Arranque inválido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'e': etapa_lanzada_con = optarg; break;
+            case 'B': ruta_bitacora = optarg; break;
+            case 'Q':
+                if ((capacidad_cola = atoi(optarg)) < 1 || capacidad_cola > COLA_MAXIMA) {
+                    fprintf(stderr, "La cola debe tener entre 1 y %d mensajes\n", COLA_MAXIMA);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'K':
+                if (atol(optarg) < 1) {
+                    fprintf(stderr, "Bytes de cola inválidos: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                bytes_cola = atol(optarg);
+                break;
+            case 'O':
+                if (strcmp(optarg, "bloquear") == 0) {
+                    sobrecarga = SOBRECARGA_BLOQUEAR;
+                } else if (strcmp(optarg, "descartar-nuevo") == 0) {
+                    sobrecarga = SOBRECARGA_DESCARTAR_NUEVO;
+                } else if (strcmp(optarg, "descartar-viejo") == 0) {
+                    sobrecarga = SOBRECARGA_DESCARTAR_VIEJO;
+                } else if (strcmp(optarg, "rechazar") == 0) {
+                    sobrecarga = SOBRECARGA_RECHAZAR;
+                } else {
+                    fprintf(stderr, "Política de sobrecarga desconocida: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'R': {
+                int leidos = sscanf(optarg, "%lfx%d", &ritmo_llegadas, &rafaga_llegadas);
+                if (leidos < 1 || ritmo_llegadas <= 0 || rafaga_llegadas < 1) {
+                    fprintf(stderr, "Llegadas inválidas: '%s' (R o RxB, mensajes/s y ráfaga)\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'U': ruta_escucha = optarg; break;
+            case 'Y':
+                if (leer_ubicaciones(optarg) == -1) return EXIT_FAILURE;
+                break;
+            case 'P': {
+                int minima = sched_get_priority_min(SCHED_FIFO), maxima = sched_get_priority_max(SCHED_FIFO);
+                if ((prioridad_fifo = atoi(optarg)) < minima || prioridad_fifo > maxima) {
+                    fprintf(stderr, "La prioridad SCHED_FIFO debe estar entre %d y %d\n", minima, maxima);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'G': paginas_enormes = 1; break;
+            case 'X':
+                if ((capacidad_conexiones = atoi(optarg)) < 1 || capacidad_conexiones > CONEXIONES_MAXIMAS) {
+                    fprintf(stderr, "Las conexiones deben estar entre 1 y %d\n", CONEXIONES_MAXIMAS);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'N':
+                if (strcmp(optarg, "error") == 0) {
+                    nivel_bitacora = BITACORA_ERROR;
+                } else if (strcmp(optarg, "info") == 0) {
+                    nivel_bitacora = BITACORA_INFO;
+                } else if (strcmp(optarg, "depuracion") == 0) {
+                    nivel_bitacora = BITACORA_DEPURACION;
+                } else {
+                    fprintf(stderr, "Nivel de bitácora desconocido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'C': {
+                long n = atol(optarg);
+                if (n < 0 || n > UINT16_MAX) {
+                    fprintf(stderr, "Carga de bitácora inválida: de 0 a %d bytes\n", UINT16_MAX);
+                    return EXIT_FAILURE;
+                }
+                carga_bitacora = n;
+                break;
+            }
+            case 'I':
+                if (strcmp(optarg, "bloqueante") == 0) {
+                    motor_es = ES_BLOQUEANTE;
+                } else if (strcmp(optarg, "uring") == 0) {
+                    motor_es = ES_URING;
+                } else {
+                    fprintf(stderr, "Motor de E/S desconocido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'M': mapeado = 1; break;
+            case 'w': trabajadores = atoi(optarg); break;
+            case 'V':
+                if (strcmp(optarg, "copia") == 0) {
+                    verificacion = VERIFICACION_COPIA;
+                } else if (strcmp(optarg, "crc") == 0) {
+                    verificacion = VERIFICACION_CRC;
+                } else if (strcmp(optarg, "flujo") == 0) {
+                    verificacion = VERIFICACION_FLUJO;
+                } else {
+                    fprintf(stderr, "Verificación desconocida: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'H':
+                if ((hilos = atoi(optarg)) < 0) {
+                    fprintf(stderr, "Hilos inválidos: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'r': {
+                // Cada configuración es "N" (todas las etapas) o "N1xN2xN3".
+                num_configuraciones = 0;
+                for (char *p = strtok(optarg, ","); p != NULL; p = strtok(NULL, ",")) {
+                    int *c = configuraciones[num_configuraciones];
+                    int leidos = num_configuraciones < MAX_CONFIGURACIONES
+                                     ? sscanf(p, "%dx%dx%d", &c[0], &c[1], &c[2]) : 0;
+                    if (leidos == 1) c[1] = c[2] = c[0];
+                    if ((leidos != 1 && leidos != 3) || c[0] < 1 || c[0] > MAX_REPLICAS ||
+                        c[1] < 1 || c[1] > MAX_REPLICAS || c[2] < 1 || c[2] > MAX_REPLICAS) {
+                        fprintf(stderr, "Réplicas inválidas: '%s' (hasta %d configuraciones N o N1xN2xN3, "
+                                        "de 1 a %d por etapa)\n", p, MAX_CONFIGURACIONES, MAX_REPLICAS);
+                        return EXIT_FAILURE;
+                    }
+                    num_configuraciones++;
+                }
+                if (num_configuraciones == 0) {
+                    fprintf(stderr, "Réplicas inválidas: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'F':
+                if (strcmp(optarg, "texto") == 0) {
+                    formato = FORMATO_TEXTO;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    formato = FORMATO_CSV;
+                } else if (strcmp(optarg, "json") == 0) {
+                    formato = FORMATO_JSON;
+                } else {
+                    fprintf(stderr, "Formato desconocido: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'g': giros_notificacion = atoi(optarg); break;
+            case 'L': latencia = optarg ? atoi(optarg) : 10000; break;
+            case 'h': uso(argv[0]); return EXIT_SUCCESS;
+            default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    seleccionar_kernels();
+    seleccionar_crc32c();
+    if (etapa_lanzada_con != NULL) {
+        lote = lotes[0];
+        memcpy(replicas, configuraciones[0], sizeof(replicas));
+        return etapa_lanzada(etapa_lanzada_con);
+    }
+    if (autoprueba) {
+        return autoprueba_kernels();
+    }
+    if (latencia > 0) {
+        return medir_latencia_despertar(latencia);
+    }
+    if (mapeado) {
+        if (argc - optind != 2) {
+            fprintf(stderr, "--mapeado necesita un archivo de entrada y uno de salida\n");
+            return EXIT_FAILURE;
+        }
+        return modo_mapeado(argv[optind], argv[optind + 1], trabajadores);
+    }
+    ubicar_proceso("Servidor", 0, 0);
+    if (ruta_bitacora != NULL) bitacora_crear();
+    if (flujo) {
+        // La reserva se arma antes de abrir la entrada, para que los trabajadores
+        // no hereden su descriptor, con tantos puestos como la mayor configuración.
+        int procesos_maximos = 0, con_reserva = 0;
+        for (int c = 0; c < num_configuraciones; c++) {
+            int n = configuraciones[c][0] + configuraciones[c][1] + configuraciones[c][2];
+            if (n > procesos_maximos) procesos_maximos = n;
+        }
+        for (int a = 0; a < num_arranques; a++) con_reserva |= arranques[a] == ARRANQUE_RESERVA;
+        if (con_reserva && modo_notificacion == NOTIFICACION_EVENTFD) {
+            // Los eventfd de los anillos se crean en cada corrida y la reserva ya existe.
+            fprintf(stderr, "--arranque reserva no admite -n eventfd\n");
+            return EXIT_FAILURE;
+        }
+        if (motor_es == ES_URING) {
+            // Se prueba una vez aquí; si no hay io_uring se sigue con read/write.
+            uring_t prueba;
+            if (uring_iniciar(&prueba, 8) == -1) {
+                fprintf(stderr, "io_uring no disponible (%s): se usa read/write\n", strerror(errno));
+                motor_es = ES_BLOQUEANTE;
+            } else {
+                uring_destruir(&prueba);
+            }
+        }
+        if (ruta_escucha != NULL) {
+            // El frontal espera los resultados con epoll sobre fifo_result, así que
+            // necesita una FIFO leída con read(); y corre una sola vez, hasta una señal.
+            if (num_transportes != 1 || transportes[0] != TRANSPORTE_FIFO || motor_es != ES_BLOQUEANTE ||
+                num_arranques * num_lotes * num_configuraciones != 1) {
+                fprintf(stderr, "--escuchar requiere -t fifo, --es bloqueante y una sola configuración\n");
+                return EXIT_FAILURE;
+            }
+            // Ctrl-C llega a todo el grupo de procesos: las etapas lo ignoran y
+            // terminan cuando el servidor, que sí lo atiende, cierra fifo_message.
+            signal(SIGINT, SIG_IGN);
+        }
+        if (con_reserva) reserva_preparar(procesos_maximos);
+
+        FILE *entrada = stdin;
+        if (ruta_escucha == NULL && optind < argc && strcmp(argv[optind], "-") != 0) {
+            if ((entrada = fopen(argv[optind], "r")) == NULL) {
+                perror(argv[optind]);
+                return EXIT_FAILURE;
+            }
+        }
+        // Comparación directa: la misma carga se repite con cada arranque, transporte,
+        // lote y configuración de réplicas.
+        int estado = EXIT_SUCCESS;
+        double mensajes_s[MAX_CONFIGURACIONES];
+        int por_arranque = num_transportes * num_lotes * num_configuraciones;
+        for (int i = 0; i < num_arranques * por_arranque; i++) {
+            if (i > 0 && fseek(entrada, 0, SEEK_SET) == -1) {
+                perror("Servidor: repetir la carga requiere un archivo, no una tubería");
+                return EXIT_FAILURE;
+            }
+            int j = i % por_arranque, c = j % num_configuraciones;
+            arranque = arranques[i / por_arranque];
+            lote = lotes[j / num_configuraciones % num_lotes];
+            memcpy(replicas, configuraciones[c], sizeof(replicas));
+            enum transporte tipo = transportes[j / num_configuraciones / num_lotes];
+            if (tipo == TRANSPORTE_FUSIONADO) {
+                // Sin canales ni procesos: arranque, lotes y réplicas no aplican, se corre una vez.
+                if (i < por_arranque && j % (num_configuraciones * num_lotes) == 0 &&
+                    modo_fusionado(entrada, NULL) != EXIT_SUCCESS) estado = EXIT_FAILURE;
+                continue;
+            }
+            if (modo_flujo(entrada, tipo, &mensajes_s[c]) != EXIT_SUCCESS) estado = EXIT_FAILURE;
+            if (c == num_configuraciones - 1 && num_configuraciones > 1 && formato == FORMATO_TEXTO) {
+                reportar_escalado(tipo, configuraciones, num_configuraciones, mensajes_s);
+            }
+        }
+        reserva_cerrar(0);
+        return estado;
+    }
+
+    // 1. Crear los eventos de sincronización en memoria compartida (heredada por los hijos)
+    sincronizacion = mmap(NULL, sizeof(sincronizacion_t), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (sincronizacion == MAP_FAILED) {
+        perror("Servidor: mmap sincronizacion");
         exit(EXIT_FAILURE);
     }
+    for (int i = 0; i < 3; i++) {
+        if (evento_iniciar(&sincronizacion->inicio[i], modo_notificacion, giros_notificacion) == -1 ||
+            evento_iniciar(&sincronizacion->fin[i], modo_notificacion, giros_notificacion) == -1) {
+            perror("Servidor: eventfd");
+            exit(EXIT_FAILURE);
+        }
+    }
 
     // 2. Proceso Padre (Servidor): Crea las tuberías con nombre
     printf("Servidor (PID: %d): Creando tuberías con nombre...\n", getpid());
@@ -107,6 +4046,18 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
+    // Cada etapa escribe y cierra su tubería antes de que la siguiente la abra; el
+    // servidor mantiene un descriptor O_RDWR en cada una para que esos open() no
+    // se bloqueen y los datos no se descarten al cerrarse el último descriptor.
+    int anclas[4];
+    const char *fifos_clasico[] = { FIFO_MESSAGE, FIFO_ENCRYPT, FIFO_DECRYPT, FIFO_RESULT };
+    for (int i = 0; i < 4; i++) {
+        if ((anclas[i] = open(fifos_clasico[i], O_RDWR)) == -1) {
+            perror("Servidor: open O_RDWR");
+            exit(EXIT_FAILURE);
+        }
+    }
+
     printf("Servidor: Ingrese la cadena a procesar: ");
     if (fgets(original_message, BUFFER_SIZE, stdin) == NULL) {
         perror("fgets");
@@ -124,35 +4075,24 @@ int main() {
         exit(EXIT_FAILURE);
     }
     if (client1_pid == 0) { // Código para Cliente 1
-      
-        struct sigaction sa_client;
-        sa_client.sa_handler = client_signal_handler;
-        sigemptyset(&sa_client.sa_mask);
-        sa_client.sa_flags = SA_RESTART;
-        if (sigaction(SIGUSR1, &sa_client, NULL) == -1) {
-            perror("Cliente 1: sigaction");
-            exit(EXIT_FAILURE);
-        }
-
-        printf("Cliente 1 (PID: %d): Esperando señal del servidor para iniciar...\n", getpid());
-        while (!start_task) {
-            pause(); // Espera la señal del servidor
-        }
-        start_task = 0; 
+        printf("Cliente 1 (PID: %d): Esperando al servidor para iniciar...\n", getpid());
+        bitacora_iniciar(1, 0, 1);
+        ubicar_proceso("Cliente 1", 1, 0);
+        esperar_notificacion(&sincronizacion->inicio[0], 0);
 
-        printf("Cliente 1: Señal recibida. Abriendo %s para lectura...\n", FIFO_MESSAGE);
+        printf("Cliente 1: Notificación recibida. Abriendo %s para lectura...\n", FIFO_MESSAGE);
         if ((fd = open(FIFO_MESSAGE, O_RDONLY)) == -1) {
             perror("Cliente 1: open fifo_message");
             exit(EXIT_FAILURE);
         }
-        ssize_t bytes_read = read(fd, processed_message, BUFFER_SIZE);
+        ssize_t bytes_read = read(fd, processed_message, BUFFER_SIZE - 1); // Deja lugar para el '\0'
         close(fd);
         if (bytes_read == -1) {
             perror("Cliente 1: read fifo_message");
             exit(EXIT_FAILURE);
         }
         processed_message[bytes_read] = '\0';
-        printf("Cliente 1: Cadena leída: '%s'\n", processed_message);
+        mostrar_cadena("Cliente 1", "leída", EVENTO_LEIDO, processed_message);
 
         if (strlen(processed_message) == 0) {
             fprintf(stderr, "Cliente 1: Cadena vacía recibida. Finalizando con error.\n");
@@ -160,7 +4100,7 @@ int main() {
         }
 
         encrypt_string(processed_message);
-        printf("Cliente 1: Cadena encriptada: '%s'\n", processed_message);
+        mostrar_cadena("Cliente 1", "encriptada", EVENTO_TRANSFORMADO, processed_message);
 
         if ((fd = open(FIFO_ENCRYPT, O_WRONLY)) == -1) {
             perror("Cliente 1: open fifo_encrypt");
@@ -173,9 +4113,7 @@ int main() {
         close(fd);
         printf("Cliente 1: Cadena escrita en %s. Notificando al servidor y terminando.\n", FIFO_ENCRYPT);
 
-        if (kill(getppid(), SIGUSR1) == -1) { 
-            perror("Cliente 1: kill SIGUSR1 to server");
-        }
+        evento_notificar(&sincronizacion->fin[0]);
         exit(EXIT_SUCCESS);
     }
 
@@ -189,34 +4127,24 @@ int main() {
             exit(EXIT_FAILURE);
         }
         if (client2_pid == 0) { // Código para Cliente 2
-            struct sigaction sa_client;
-            sa_client.sa_handler = client_signal_handler;
-            sigemptyset(&sa_client.sa_mask);
-            sa_client.sa_flags = SA_RESTART;
-            if (sigaction(SIGUSR1, &sa_client, NULL) == -1) {
-                perror("Cliente 2: sigaction");
-                exit(EXIT_FAILURE);
-            }
+            printf("Cliente 2 (PID: %d): Esperando al servidor para iniciar...\n", getpid());
+            bitacora_iniciar(2, 0, 1);
+            ubicar_proceso("Cliente 2", 2, 0);
+            esperar_notificacion(&sincronizacion->inicio[1], 0);
 
-            printf("Cliente 2 (PID: %d): Esperando señal del servidor para iniciar...\n", getpid());
-            while (!start_task) {
-                pause();
-            }
-            start_task = 0;
-
-            printf("Cliente 2: Señal recibida. Abriendo %s para lectura...\n", FIFO_ENCRYPT);
+            printf("Cliente 2: Notificación recibida. Abriendo %s para lectura...\n", FIFO_ENCRYPT);
             if ((fd = open(FIFO_ENCRYPT, O_RDONLY)) == -1) {
                 perror("Cliente 2: open fifo_encrypt");
                 exit(EXIT_FAILURE);
             }
-            ssize_t bytes_read = read(fd, processed_message, BUFFER_SIZE);
+            ssize_t bytes_read = read(fd, processed_message, BUFFER_SIZE - 1); // Deja lugar para el '\0'
             close(fd);
             if (bytes_read == -1) {
                 perror("Cliente 2: read fifo_encrypt");
                 exit(EXIT_FAILURE);
             }
             processed_message[bytes_read] = '\0';
-            printf("Cliente 2: Cadena leída: '%s'\n", processed_message);
+            mostrar_cadena("Cliente 2", "leída", EVENTO_LEIDO, processed_message);
 
             if (strlen(processed_message) == 0) {
                 fprintf(stderr, "Cliente 2: Cadena vacía recibida. Finalizando con error.\n");
@@ -224,7 +4152,7 @@ int main() {
             }
 
             reverse_string(processed_message);
-            printf("Cliente 2: Cadena invertida: '%s'\n", processed_message);
+            mostrar_cadena("Cliente 2", "invertida", EVENTO_TRANSFORMADO, processed_message);
 
             if ((fd = open(FIFO_DECRYPT, O_WRONLY)) == -1) {
                 perror("Cliente 2: open fifo_decrypt");
@@ -237,9 +4165,7 @@ int main() {
             close(fd);
             printf("Cliente 2: Cadena escrita en %s. Notificando al servidor y terminando.\n", FIFO_DECRYPT);
 
-            if (kill(getppid(), SIGUSR1) == -1) {
-                perror("Cliente 2: kill SIGUSR1 to server");
-            }
+            evento_notificar(&sincronizacion->fin[1]);
             exit(EXIT_SUCCESS);
         }
     }
@@ -252,34 +4178,24 @@ int main() {
             exit(EXIT_FAILURE);
         }
         if (client3_pid == 0) { // Código para Cliente 3
-            struct sigaction sa_client;
-            sa_client.sa_handler = client_signal_handler;
-            sigemptyset(&sa_client.sa_mask);
-            sa_client.sa_flags = SA_RESTART;
-            if (sigaction(SIGUSR1, &sa_client, NULL) == -1) {
-                perror("Cliente 3: sigaction");
-                exit(EXIT_FAILURE);
-            }
-
-            printf("Cliente 3 (PID: %d): Esperando señal del servidor para iniciar...\n", getpid());
-            while (!start_task) {
-                pause();
-            }
-            start_task = 0;
+            printf("Cliente 3 (PID: %d): Esperando al servidor para iniciar...\n", getpid());
+            bitacora_iniciar(3, 0, 1);
+            ubicar_proceso("Cliente 3", 3, 0);
+            esperar_notificacion(&sincronizacion->inicio[2], 0);
 
-            printf("Cliente 3: Señal recibida. Abriendo %s para lectura...\n", FIFO_DECRYPT);
+            printf("Cliente 3: Notificación recibida. Abriendo %s para lectura...\n", FIFO_DECRYPT);
             if ((fd = open(FIFO_DECRYPT, O_RDONLY)) == -1) {
                 perror("Cliente 3: open fifo_decrypt");
                 exit(EXIT_FAILURE);
             }
-            ssize_t bytes_read = read(fd, processed_message, BUFFER_SIZE);
+            ssize_t bytes_read = read(fd, processed_message, BUFFER_SIZE - 1); // Deja lugar para el '\0'
             close(fd);
             if (bytes_read == -1) {
                 perror("Cliente 3: read fifo_decrypt");
                 exit(EXIT_FAILURE);
             }
             processed_message[bytes_read] = '\0';
-            printf("Cliente 3: Cadena leída: '%s'\n", processed_message);
+            mostrar_cadena("Cliente 3", "leída", EVENTO_LEIDO, processed_message);
 
             if (strlen(processed_message) == 0) {
                 fprintf(stderr, "Cliente 3: Cadena vacía recibida. Finalizando con error.\n");
@@ -287,7 +4203,7 @@ int main() {
             }
 
             decrypt_string(processed_message);
-            printf("Cliente 3: Cadena desencriptada: '%s'\n", processed_message);
+            mostrar_cadena("Cliente 3", "desencriptada", EVENTO_TRANSFORMADO, processed_message);
 
             if ((fd = open(FIFO_RESULT, O_WRONLY)) == -1) {
                 perror("Cliente 3: open fifo_result");
@@ -300,9 +4216,7 @@ int main() {
             close(fd);
             printf("Cliente 3: Cadena escrita en %s. Notificando al servidor y terminando.\n", FIFO_RESULT);
 
-            if (kill(getppid(), SIGUSR1) == -1) {
-                perror("Cliente 3: kill SIGUSR1 to server");
-            }
+            evento_notificar(&sincronizacion->fin[2]);
             exit(EXIT_SUCCESS);
         }
     }
@@ -311,7 +4225,14 @@ int main() {
     // Solo el padre debe ejecutar esta parte
     if (client1_pid > 0 && client2_pid > 0 && client3_pid > 0) {
         printf("Servidor: Todos los clientes creados.\n");
-        printf("Servidor: Enviando mensaje inicial a Cliente 1: '%s' a través de %s...\n", original_message, FIFO_MESSAGE);
+        bitacora_iniciar(0, 0, 1);
+        if (bitacora.nivel != BITACORA_NINGUNO) {
+            size_t n = strlen(original_message);
+            bitacora_registrar(BITACORA_DEPURACION, EVENTO_ENVIADO, 0, n, original_message, n);
+            printf("Servidor: Enviando mensaje inicial a Cliente 1 a través de %s...\n", FIFO_MESSAGE);
+        } else {
+            printf("Servidor: Enviando mensaje inicial a Cliente 1: '%s' a través de %s...\n", original_message, FIFO_MESSAGE);
+        }
         if ((fd = open(FIFO_MESSAGE, O_WRONLY)) == -1) {
             perror("Servidor: open fifo_message");
             exit(EXIT_FAILURE);
@@ -324,54 +4245,36 @@ int main() {
         printf("Servidor: Mensaje inicial enviado. Notificando a Cliente 1 para comenzar.\n");
 
         // Notificar a Cliente 1 para que comience
-        if (kill(client1_pid, SIGUSR1) == -1) {
-            perror("Servidor: kill SIGUSR1 to client1");
-            exit(EXIT_FAILURE);
-        }
+        evento_notificar(&sincronizacion->inicio[0]);
 
         // Esperar a que Cliente 1 termine.
         printf("Servidor: Esperando que Cliente 1 termine y notifique...\n");
-        while (!client1_finished) {
-            pause();
-        }
+        esperar_notificacion(&sincronizacion->fin[0], 0);
         printf("Servidor: Cliente 1 ha terminado. Notificando a Cliente 2 para comenzar.\n");
-        // No es necesario resetear client1_finished aquí si el flujo es estrictamente secuencial y solo un cliente
-        // enviará SIGUSR1 por vez al servidor en cada etapa.
+        // Cada evento se notifica una sola vez por ejecución, por eso basta esperar a que deje de valer 0.
 
         // Notificar a Cliente 2 para que comience
-        if (kill(client2_pid, SIGUSR1) == -1) {
-            perror("Servidor: kill SIGUSR1 to client2");
-            exit(EXIT_FAILURE);
-        }
+        evento_notificar(&sincronizacion->inicio[1]);
 
         // Esperar a que Cliente 2 termine.
         printf("Servidor: Esperando que Cliente 2 termine y notifique...\n");
-        while (!client2_finished) {
-            pause();
-        }
+        esperar_notificacion(&sincronizacion->fin[1], 0);
         printf("Servidor: Cliente 2 ha terminado. Notificando a Cliente 3 para comenzar.\n");
-        // client2_finished = 0;
 
         // Notificar a Cliente 3 para que comience
-        if (kill(client3_pid, SIGUSR1) == -1) {
-            perror("Servidor: kill SIGUSR1 to client3");
-            exit(EXIT_FAILURE);
-        }
+        evento_notificar(&sincronizacion->inicio[2]);
 
         // Esperar a que Cliente 3 termine.
         printf("Servidor: Esperando que Cliente 3 termine y notifique...\n");
-        while (!client3_finished) {
-            pause();
-        }
+        esperar_notificacion(&sincronizacion->fin[2], 0);
         printf("Servidor: Cliente 3 ha terminado. Leyendo resultado final.\n");
-        // client3_finished = 0;
 
         // El Servidor recibe el mensaje final desde fifo_result y lo imprime.
         if ((fd = open(FIFO_RESULT, O_RDONLY)) == -1) {
             perror("Servidor: open fifo_result");
             exit(EXIT_FAILURE);
         }
-        ssize_t bytes_read = read(fd, processed_message, BUFFER_SIZE);
+        ssize_t bytes_read = read(fd, processed_message, BUFFER_SIZE - 1); // Deja lugar para el '\0'
         close(fd);
         if (bytes_read == -1) {
             perror("Servidor: read fifo_result");
@@ -379,13 +4282,19 @@ int main() {
         }
         processed_message[bytes_read] = '\0'; // Asegurar terminación nula
 
-        printf("Servidor: Mensaje final recibido: '%s'\n", processed_message);
+        if (bitacora.nivel != BITACORA_NINGUNO) {
+            size_t n = strlen(processed_message);
+            bitacora_registrar(BITACORA_DEPURACION, EVENTO_RECIBIDO, 0, n, processed_message, n);
+        } else {
+            printf("Servidor: Mensaje final recibido: '%s'\n", processed_message);
+        }
 
         // Verifica si el mensaje final coincide con la cadena original.
         if (strcmp(original_message, processed_message) == 0) {
             printf("Servidor: El mensaje final coincide con la cadena original. Si\n");
         } else {
             printf("Servidor: El mensaje final NO coincide con la cadena original. No\n");
+            bitacora_registrar(BITACORA_ERROR, EVENTO_DISCREPANCIA, 0, strlen(processed_message), NULL, 0);
         }
 
         // Esperar a que todos los hijos terminen explícitamente para limpiar procesos zombies
@@ -394,6 +4303,14 @@ int main() {
         waitpid(client3_pid, NULL, 0);
         printf("Servidor: Todos los clientes han terminado.\n");
 
+        for (int i = 0; i < 4; i++) {
+            close(anclas[i]);
+        }
+        for (int i = 0; i < 3; i++) {
+            evento_destruir(&sincronizacion->inicio[i]);
+            evento_destruir(&sincronizacion->fin[i]);
+        }
+
         // El Servidor elimina las tuberías con nombre al finalizar.
         printf("Servidor: Eliminando tuberías con nombre...\n");
         if (unlink(FIFO_MESSAGE) == -1) {
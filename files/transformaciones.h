@@ -0,0 +1,171 @@
+#ifndef TRANSFORMACIONES_H
+#define TRANSFORMACIONES_H
+
+// Núcleos de las tres transformaciones sobre (puntero, longitud), sin buscar el
+// '\0'. Hay una versión escalar y, en x86-64, versiones SSE2 y AVX2; la que se
+// usa se elige una sola vez según la CPU con seleccionar_kernels().
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define DESPLAZAMIENTO_CIFRADO 3
+
+typedef void (*kernel_t)(char *buf, size_t len);
+
+typedef struct {
+    const char *nombre;
+    kernel_t cifrar;
+    kernel_t descifrar;
+    kernel_t invertir;
+} implementacion_t;
+
+// --- Escalar ---------------------------------------------------------------
+
+static void cifrar_escalar(char *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) buf[i] += DESPLAZAMIENTO_CIFRADO;
+}
+
+static void descifrar_escalar(char *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) buf[i] -= DESPLAZAMIENTO_CIFRADO;
+}
+
+static void invertir_escalar(char *buf, size_t len) {
+    if (len < 2) return;
+    for (size_t i = 0, j = len - 1; i < j; i++, j--) {
+        char temp = buf[i];
+        buf[i] = buf[j];
+        buf[j] = temp;
+    }
+}
+
+#if defined(__x86_64__)
+
+// --- SSE2 (siempre disponible en x86-64) -----------------------------------
+
+static void sumar_sse2(char *buf, size_t len, char delta) {
+    __m128i d = _mm_set1_epi8(delta);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        _mm_storeu_si128((__m128i *)(buf + i), _mm_add_epi8(v, d));
+    }
+    for (; i < len; i++) buf[i] += delta;
+}
+
+static void cifrar_sse2(char *buf, size_t len) { sumar_sse2(buf, len, DESPLAZAMIENTO_CIFRADO); }
+static void descifrar_sse2(char *buf, size_t len) { sumar_sse2(buf, len, -DESPLAZAMIENTO_CIFRADO); }
+
+// Invierte los 16 bytes de v sin pshufb (SSSE3): palabras de 32 bits, luego de
+// 16 bits y por último los dos bytes de cada palabra de 16 bits.
+static inline __m128i invertir_16_sse2(__m128i v) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+// Intercambia bloques de los dos extremos invirtiéndolos; el centro que queda
+// (menos de dos bloques) se resuelve con la versión escalar.
+static void invertir_sse2(char *buf, size_t len) {
+    size_t i = 0, j = len;
+    while (j - i >= 32) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(buf + j - 16));
+        _mm_storeu_si128((__m128i *)(buf + i), invertir_16_sse2(b));
+        _mm_storeu_si128((__m128i *)(buf + j - 16), invertir_16_sse2(a));
+        i += 16;
+        j -= 16;
+    }
+    invertir_escalar(buf + i, j - i);
+}
+
+// --- AVX2 ------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static void sumar_avx2(char *buf, size_t len, char delta) {
+    __m256i d = _mm256_set1_epi8(delta);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)(buf + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(buf + i + 32));
+        _mm256_storeu_si256((__m256i *)(buf + i), _mm256_add_epi8(v0, d));
+        _mm256_storeu_si256((__m256i *)(buf + i + 32), _mm256_add_epi8(v1, d));
+    }
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+        _mm256_storeu_si256((__m256i *)(buf + i), _mm256_add_epi8(v, d));
+    }
+    for (; i < len; i++) buf[i] += delta;
+}
+
+__attribute__((target("avx2")))
+static void cifrar_avx2(char *buf, size_t len) { sumar_avx2(buf, len, DESPLAZAMIENTO_CIFRADO); }
+
+__attribute__((target("avx2")))
+static void descifrar_avx2(char *buf, size_t len) { sumar_avx2(buf, len, -DESPLAZAMIENTO_CIFRADO); }
+
+// pshufb invierte dentro de cada carril de 128 bits y la permutación cruza los carriles.
+__attribute__((target("avx2")))
+static inline __m256i invertir_32_avx2(__m256i v) {
+    const __m256i mascara = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                             15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    v = _mm256_shuffle_epi8(v, mascara);
+    return _mm256_permute2x128_si256(v, v, 0x01);
+}
+
+__attribute__((target("avx2")))
+static void invertir_avx2(char *buf, size_t len) {
+    size_t i = 0, j = len;
+    while (j - i >= 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(buf + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(buf + j - 32));
+        _mm256_storeu_si256((__m256i *)(buf + i), invertir_32_avx2(b));
+        _mm256_storeu_si256((__m256i *)(buf + j - 32), invertir_32_avx2(a));
+        i += 32;
+        j -= 32;
+    }
+    invertir_sse2(buf + i, j - i);
+}
+
+#endif // __x86_64__
+
+static const implementacion_t implementaciones[] = {
+    { "escalar", cifrar_escalar, descifrar_escalar, invertir_escalar },
+#if defined(__x86_64__)
+    { "sse2", cifrar_sse2, descifrar_sse2, invertir_sse2 },
+    { "avx2", cifrar_avx2, descifrar_avx2, invertir_avx2 },
+#endif
+};
+
+#define NUM_IMPLEMENTACIONES (sizeof(implementaciones) / sizeof(implementaciones[0]))
+
+// Verdadero si la CPU puede ejecutar la implementación indicada.
+static int implementacion_soportada(const implementacion_t *impl) {
+#if defined(__x86_64__)
+    if (strcmp(impl->nombre, "avx2") == 0) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    (void)impl;
+    return 1;
+}
+
+static const implementacion_t *kernels = &implementaciones[0];
+
+// Elige la implementación más rápida que soporta la CPU.
+static void seleccionar_kernels(void) {
+    for (size_t i = 0; i < NUM_IMPLEMENTACIONES; i++) {
+        if (implementacion_soportada(&implementaciones[i])) kernels = &implementaciones[i];
+    }
+}
+
+static inline void encrypt_buffer(char *buf, size_t len) { kernels->cifrar(buf, len); }
+static inline void decrypt_buffer(char *buf, size_t len) { kernels->descifrar(buf, len); }
+static inline void reverse_buffer(char *buf, size_t len) { kernels->invertir(buf, len); }
+
+#endif
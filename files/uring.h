@@ -0,0 +1,173 @@
+#ifndef URING_H
+#define URING_H
+
+// io_uring mínimo sobre las llamadas al sistema, sin liburing: crear el anillo,
+// preparar entradas de envío (SQE), entrar al kernel una vez para enviar todo
+// lo preparado y esperar, y recoger las compleciones (CQE). Las entradas
+// preparadas no llegan al kernel hasta la siguiente uring_entrar(), así varias
+// lecturas y escrituras salen juntas en una sola llamada.
+//
+// Requiere IORING_FEAT_EXT_ARG (Linux 5.11) para esperar con plazo; si el
+// kernel no lo tiene, o io_uring está deshabilitado, uring_iniciar() falla y el
+// llamador sigue con read/write.
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+typedef struct {
+    int fd;
+    unsigned *sq_cabeza, *sq_cola, *sq_mascara, *sq_indices;
+    unsigned *cq_cabeza, *cq_cola, *cq_mascara;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned cola_local;        // Hasta dónde se prepararon SQEs; se publica al entrar
+    void *sq_mapa, *cq_mapa;
+    size_t sq_tam, cq_tam, sqes_tam;
+} uring_t;
+
+static inline void uring_destruir(uring_t *u) {
+    if (u->sqes != NULL && u->sqes != MAP_FAILED) munmap(u->sqes, u->sqes_tam);
+    if (u->cq_mapa != NULL && u->cq_mapa != MAP_FAILED && u->cq_mapa != u->sq_mapa) munmap(u->cq_mapa, u->cq_tam);
+    if (u->sq_mapa != NULL && u->sq_mapa != MAP_FAILED) munmap(u->sq_mapa, u->sq_tam);
+    if (u->fd >= 0) close(u->fd);
+    memset(u, 0, sizeof(*u));
+    u->fd = -1;
+}
+
+static inline int uring_iniciar(uring_t *u, unsigned entradas) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(u, 0, sizeof(*u));
+    u->fd = (int)syscall(__NR_io_uring_setup, entradas, &p);
+    if (u->fd < 0) {
+        u->fd = -1;
+        return -1;
+    }
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        uring_destruir(u);
+        errno = ENOSYS;
+        return -1;
+    }
+    u->sq_tam = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_tam = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_tam > u->sq_tam) u->sq_tam = u->cq_tam;
+        u->cq_tam = u->sq_tam;
+    }
+    u->sq_mapa = mmap(NULL, u->sq_tam, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                      IORING_OFF_SQ_RING);
+    if (u->sq_mapa == MAP_FAILED) goto error;
+    u->cq_mapa = p.features & IORING_FEAT_SINGLE_MMAP
+                     ? u->sq_mapa
+                     : mmap(NULL, u->cq_tam, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                            IORING_OFF_CQ_RING);
+    if (u->cq_mapa == MAP_FAILED) goto error;
+    u->sqes_tam = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_tam, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                   IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) goto error;
+
+    char *sq = u->sq_mapa, *cq = u->cq_mapa;
+    u->sq_cabeza = (unsigned *)(sq + p.sq_off.head);
+    u->sq_cola = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mascara = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_indices = (unsigned *)(sq + p.sq_off.array);
+    u->cq_cabeza = (unsigned *)(cq + p.cq_off.head);
+    u->cq_cola = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mascara = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    u->cola_local = *u->sq_cola;
+    return 0;
+
+error: {
+        int e = errno;
+        uring_destruir(u);
+        errno = e;
+        return -1;
+    }
+}
+
+// Registra descriptores: las SQE con IOSQE_FIXED_FILE los nombran por índice
+// y el kernel no tiene que buscar y referenciar el archivo en cada operación.
+static inline int uring_registrar_archivos(uring_t *u, const int *fds, unsigned n) {
+    return (int)syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_FILES, fds, n);
+}
+
+// Libera el índice 'indice': el anillo deja de retener el archivo, así cerrar
+// el descriptor cierra de verdad la FIFO (y el lector ve fin de flujo).
+static inline int uring_soltar_archivo(uring_t *u, unsigned indice) {
+    int vacio = -1;
+    struct io_uring_files_update cambio;
+    memset(&cambio, 0, sizeof(cambio));
+    cambio.offset = indice;
+    cambio.fds = (uint64_t)(uintptr_t)&vacio;
+    return (int)syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_FILES_UPDATE, &cambio, 1) < 0 ? -1 : 0;
+}
+
+// SQEs preparadas que el kernel todavía no vio.
+static inline unsigned uring_sin_enviar(const uring_t *u) {
+    return u->cola_local - __atomic_load_n(u->sq_cabeza, __ATOMIC_ACQUIRE);
+}
+
+// Siguiente SQE libre, en cero; NULL si la cola de envío está llena.
+static inline struct io_uring_sqe *uring_sqe(uring_t *u) {
+    if (uring_sin_enviar(u) > *u->sq_mascara) return NULL;
+    unsigned i = u->cola_local & *u->sq_mascara;
+    u->sq_indices[i] = i;
+    u->cola_local++;
+    memset(&u->sqes[i], 0, sizeof(u->sqes[i]));
+    return &u->sqes[i];
+}
+
+static inline void uring_preparar(struct io_uring_sqe *sqe, int opcode, int fijo, const void *direccion,
+                                  unsigned longitud, uint64_t dato) {
+    sqe->opcode = opcode;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = fijo;
+    sqe->off = (uint64_t)-1;    // Posición actual: las FIFOs no admiten desplazamientos
+    sqe->addr = (uint64_t)(uintptr_t)direccion;
+    sqe->len = longitud;
+    sqe->user_data = dato;
+}
+
+// Publica y envía las SQEs preparadas; si 'esperar', bloquea hasta que haya al
+// menos una compleción o venza 'plazo' (NULL: sin plazo). Devuelve -1 con errno
+// (ETIME si venció el plazo).
+static inline int uring_entrar(uring_t *u, int esperar, const struct timespec *plazo) {
+    __atomic_store_n(u->sq_cola, u->cola_local, __ATOMIC_RELEASE);
+    unsigned flags = esperar ? IORING_ENTER_GETEVENTS : 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    void *argumento = NULL;
+    size_t tam_argumento = 0;
+    if (esperar && plazo != NULL) {
+        ts.tv_sec = plazo->tv_sec;
+        ts.tv_nsec = plazo->tv_nsec;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        argumento = &arg;
+        tam_argumento = sizeof(arg);
+    }
+    return (int)syscall(__NR_io_uring_enter, u->fd, uring_sin_enviar(u), esperar ? 1 : 0, flags,
+                        argumento, tam_argumento) < 0 ? -1 : 0;
+}
+
+// Compleción más antigua sin consumir, o NULL.
+static inline struct io_uring_cqe *uring_cqe(uring_t *u) {
+    unsigned cabeza = *u->cq_cabeza;
+    if (cabeza == __atomic_load_n(u->cq_cola, __ATOMIC_ACQUIRE)) return NULL;
+    return &u->cqes[cabeza & *u->cq_mascara];
+}
+
+static inline void uring_cqe_visto(uring_t *u) {
+    __atomic_store_n(u->cq_cabeza, *u->cq_cabeza + 1, __ATOMIC_RELEASE);
+}
+
+#endif